@@ -1,4 +0,0 @@
-float DENSITY(float3 worldPos)
-{
-	return -ws.y;
-}
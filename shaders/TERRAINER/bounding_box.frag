@@ -0,0 +1,7 @@
+#version 410
+
+// Only used for occlusion queries: nothing gets written.
+
+void main()
+{
+}
@@ -0,0 +1,17 @@
+#version 410
+
+// Axis-aligned box drawn as a 14-vertex triangle strip, without any vertex
+// buffer: each bit of the masks tells whether the corner reached by the
+// corresponding vertex is on the max side along that axis.
+
+uniform mat4 vertex_world_to_clip;
+uniform vec3 box_min;
+uniform vec3 box_max;
+
+void main()
+{
+	int b = 1 << gl_VertexID;
+	vec3 corner = vec3((0x287a & b) != 0, (0x02af & b) != 0, (0x31e3 & b) != 0);
+
+	gl_Position = vertex_world_to_clip * vec4(mix(box_min, box_max, corner), 1.0);
+}
@@ -0,0 +1,207 @@
+#version 410
+
+// Evaluates density() once per corner of a chunk's cell grid; one layer of
+// the lattice (constant z) is drawn at a time. density() itself is
+// generated from a density graph, which calls octave_noise(). Chunks of
+// a baked region read their corners from tile_t instead.
+
+out float density_value;
+
+uniform uint noise_seed;
+uniform int noise_mode; // NOISE_GRADIENT or NOISE_FILTERED, see noise_kind
+uniform sampler3D noise_t; // GL_RGBA8 with GL_LINEAR and GL_REPEAT, see make_noise_texels()
+uniform bool use_tile;
+uniform sampler3D tile_t; // GL_R16F or GL_R8_SNORM, see bake_density_tile()
+uniform float tile_scale;
+uniform vec3 lattice_origin; // world-space position of corner 0, the apron lying at -1
+uniform float lattice_step;
+uniform int lattice_layer;
+uniform int lattice_cells;
+uniform int face_ratios[6]; // cells of ours per cell of the neighbour across -x, +x, -y, +y, -z, +z, if coarser
+uniform int edge_ratios[12]; // cells of ours per cell of the coarsest chunk sharing each edge, see chunk_lod
+
+#define NOISE_PERIOD 32
+#define NOISE_GRADIENT 0
+#define NOISE_FILTERED 1
+
+
+// Same hash as noise_hash() in noise.cpp: the corner is wrapped to the
+// period, so the noise repeats every NOISE_PERIOD cells
+uint noise_hash(ivec3 corner)
+{
+	uvec3 c = uvec3(corner) & uvec3(NOISE_PERIOD - 1);
+	uint hash = noise_seed ^ (c.x * 0x8da6b343u) ^ (c.y * 0xd8163841u) ^ (c.z * 0xcb1ab31fu);
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// One of Perlin's twelve edge gradients, picked by the low bits of the hash
+vec3 noise_gradient(uint hash)
+{
+	uint g = hash & 15u;
+	float su = (g & 1u) != 0u ? -1.0 : 1.0;
+	float sv = (g & 2u) != 0u ? -1.0 : 1.0;
+	bool u_is_x = g < 8u;
+	bool v_is_y = g < 4u;
+	bool v_is_x = g == 12u || g == 14u;
+	return vec3((u_is_x ? su : 0.0) + (v_is_x ? sv : 0.0),
+	            (u_is_x ? 0.0 : su) + (v_is_y ? sv : 0.0),
+	            (v_is_y || v_is_x) ? 0.0 : sv);
+}
+
+// Gradient noise mapped to [0, 1] in x, and its derivatives in yzw; same as
+// gradient_noise() in noise.cpp
+vec4 gradient_noise(vec3 p)
+{
+	vec3 cell = floor(p);
+	ivec3 i = ivec3(cell);
+	vec3 f = p - cell;
+	vec3 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+	vec3 du = 30.0 * f * f * (f * (f - 2.0) + 1.0);
+
+	vec3 g000 = noise_gradient(noise_hash(i + ivec3(0, 0, 0)));
+	vec3 g100 = noise_gradient(noise_hash(i + ivec3(1, 0, 0)));
+	vec3 g010 = noise_gradient(noise_hash(i + ivec3(0, 1, 0)));
+	vec3 g110 = noise_gradient(noise_hash(i + ivec3(1, 1, 0)));
+	vec3 g001 = noise_gradient(noise_hash(i + ivec3(0, 0, 1)));
+	vec3 g101 = noise_gradient(noise_hash(i + ivec3(1, 0, 1)));
+	vec3 g011 = noise_gradient(noise_hash(i + ivec3(0, 1, 1)));
+	vec3 g111 = noise_gradient(noise_hash(i + ivec3(1, 1, 1)));
+
+	float v000 = dot(g000, f - vec3(0.0, 0.0, 0.0));
+	float v100 = dot(g100, f - vec3(1.0, 0.0, 0.0));
+	float v010 = dot(g010, f - vec3(0.0, 1.0, 0.0));
+	float v110 = dot(g110, f - vec3(1.0, 1.0, 0.0));
+	float v001 = dot(g001, f - vec3(0.0, 0.0, 1.0));
+	float v101 = dot(g101, f - vec3(1.0, 0.0, 1.0));
+	float v011 = dot(g011, f - vec3(0.0, 1.0, 1.0));
+	float v111 = dot(g111, f - vec3(1.0, 1.0, 1.0));
+
+	// The trilinear blend, expanded as k0 + k1 x + k2 y + k3 z + k4 xy +
+	// k5 yz + k6 zx + k7 xyz
+	float k0 = v000;
+	float k1 = v100 - v000;
+	float k2 = v010 - v000;
+	float k3 = v001 - v000;
+	float k4 = v000 - v100 - v010 + v110;
+	float k5 = v000 - v010 - v001 + v011;
+	float k6 = v000 - v100 - v001 + v101;
+	float k7 = v100 - v000 + v010 - v110 + v001 - v101 - v011 + v111;
+
+	vec3 gk0 = g000;
+	vec3 gk1 = g100 - g000;
+	vec3 gk2 = g010 - g000;
+	vec3 gk3 = g001 - g000;
+	vec3 gk4 = g000 - g100 - g010 + g110;
+	vec3 gk5 = g000 - g010 - g001 + g011;
+	vec3 gk6 = g000 - g100 - g001 + g101;
+	vec3 gk7 = g100 - g000 + g010 - g110 + g001 - g101 - g011 + g111;
+
+	float value = k0 + u.x * k1 + u.y * k2 + u.z * k3 + u.x * u.y * k4 + u.y * u.z * k5 + u.z * u.x * k6 + u.x * u.y * u.z * k7;
+	vec3 gradient = gk0 + u.x * gk1 + u.y * gk2 + u.z * gk3 + u.x * u.y * gk4 + u.y * u.z * gk5 + u.z * u.x * gk6 + u.x * u.y * u.z * gk7
+	              + du * vec3(k1 + u.y * k4 + u.z * k6 + u.y * u.z * k7,
+	                          k2 + u.x * k4 + u.z * k5 + u.z * u.x * k7,
+	                          k3 + u.y * k5 + u.x * k6 + u.x * u.y * k7);
+	return vec4(0.5 + 0.5 * value, 0.5 * gradient);
+}
+
+// One octave of the density: the filtered noise reads its own channel of
+// noise_t with a single hardware-filtered fetch, rather than hashing eight
+// corners; same as filtered_noise() in noise.cpp, up to the precision of
+// the filtering
+float octave_noise(vec3 p, int channel)
+{
+	if (noise_mode == NOISE_FILTERED)
+		return texture(noise_t, p / float(NOISE_PERIOD))[channel];
+	return gradient_noise(p).x;
+}
+
+// Compiled from density.graph, and linked with this shader
+float density(vec3 world_pos);
+
+
+float corner_density(ivec3 corner)
+{
+	// Tiles cover the same corners as the lattice, apron included
+	if (use_tile)
+		return texelFetch(tile_t, corner + 1, 0).r * tile_scale;
+	return density(lattice_origin + vec3(corner) * lattice_step);
+}
+
+// On chunk edges shared with a coarser chunk, diagonal ones included,
+// interpolate the samples of the coarsest one, so that all chunks sharing
+// the edge agree on where the surface crosses it
+float edge_density(ivec3 corner)
+{
+	for (int axis = 0; axis < 3; axis++) {
+		int u = corner[(axis + 1) % 3];
+		int v = corner[(axis + 2) % 3];
+		if ((u != 0 && u != lattice_cells) || (v != 0 && v != lattice_cells))
+			continue;
+		int ratio = edge_ratios[4 * axis + (v == 0 ? 0 : 2) + (u == 0 ? 0 : 1)];
+		int w = corner[axis];
+		int w_0 = w - w % ratio;
+		if (w_0 == w)
+			break; // a coarse corner, or a corner of the chunk
+		ivec3 start = corner;
+		start[axis] = w_0;
+		ivec3 end = corner;
+		end[axis] = min(w_0 + ratio, lattice_cells);
+		return mix(corner_density(start), corner_density(end), float(w - w_0) / float(ratio));
+	}
+	return corner_density(corner);
+}
+
+void main()
+{
+	// Corners are relative to the chunk: the apron lies at -1 and
+	// lattice_cells + 1
+	ivec3 corner = ivec3(ivec2(floor(gl_FragCoord.xy)), lattice_layer) - 1;
+
+	// On faces shared with a coarser chunk, interpolate the coarse samples
+	// so that both chunks agree on where the surface crosses the face;
+	// those on the edges of the face are interpolated along them first
+	bool inside = all(greaterThanEqual(corner, ivec3(0))) && all(lessThanEqual(corner, ivec3(lattice_cells)));
+	int sides_nb = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		if (corner[axis] == 0 || corner[axis] == lattice_cells)
+			sides_nb++;
+	}
+	if (inside && sides_nb >= 2) {
+		density_value = edge_density(corner);
+		return;
+	}
+	for (int face = 0; inside && face < 6; face++) {
+		int axis = face / 2;
+		int ratio = face_ratios[face];
+		if (ratio == 1 || corner[axis] != (face % 2 == 0 ? 0 : lattice_cells))
+			continue;
+
+		ivec3 u_axis = ivec3(0);
+		u_axis[(axis + 1) % 3] = 1;
+		ivec3 v_axis = ivec3(0);
+		v_axis[(axis + 2) % 3] = 1;
+		int u = corner[(axis + 1) % 3];
+		int v = corner[(axis + 2) % 3];
+		int u_0 = u - u % ratio;
+		int v_0 = v - v % ratio;
+		if (u_0 == u && v_0 == v)
+			continue; // a coarse corner
+		int u_1 = min(u_0 + ratio, lattice_cells);
+		int v_1 = min(v_0 + ratio, lattice_cells);
+		float f_u = float(u - u_0) / float(ratio);
+		float f_v = float(v - v_0) / float(ratio);
+
+		ivec3 face_origin = corner - u * u_axis - v * v_axis;
+		density_value = mix(mix(edge_density(face_origin + u_0 * u_axis + v_0 * v_axis), edge_density(face_origin + u_1 * u_axis + v_0 * v_axis), f_u),
+		                    mix(edge_density(face_origin + u_0 * u_axis + v_1 * v_axis), edge_density(face_origin + u_1 * u_axis + v_1 * v_axis), f_u),
+		                    f_v);
+		return;
+	}
+
+	density_value = corner_density(corner);
+}
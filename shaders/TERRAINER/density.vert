@@ -0,0 +1,11 @@
+#version 410
+
+// Screen-covering triangle, see resolve_deferred.vert
+
+void main()
+{
+	float x = -1.0 + float((gl_VertexID & 1) << 2);
+	float y = -1.0 + float((gl_VertexID & 2) << 1);
+
+	gl_Position = vec4(x, y, 0.0, 1.0);
+}
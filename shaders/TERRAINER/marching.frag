@@ -6,9 +6,12 @@ in vec3 vertex;
 
 uniform mat4 normal_model_to_world;
 uniform mat4 vertex_model_to_world;
-uniform vec3 camera_pos;
-uniform vec3 light_position;
-uniform vec4 light_ambient;
+layout (std140) uniform frame_data
+{
+	vec4 camera_position; // w unused
+	vec4 light_position;  // w unused
+	vec4 light_ambient;
+};
 uniform sampler2D marble_tex;
 uniform sampler3D noise_tex;
 
@@ -35,8 +38,8 @@ void main()
                   color_3.xyzw * blend_w.zzzz;
 
 
-    vec3 V = normalize(camera_pos - vertex_new);
-    vec3 L = normalize(light_position - vertex_new);
+    vec3 V = normalize(camera_position.xyz - vertex_new);
+    vec3 L = normalize(light_position.xyz - vertex_new);
     vec3 R = normalize(reflect(-L, N));
 
     vec4 light_diffuse = blended_col * max(dot(N, L), 0.0);
@@ -0,0 +1,21 @@
+#version 410
+
+// Same as terrain.vert, for chunks drawn together from a MeshPool: every
+// chunk is placed in the world by its own transform, read per instance,
+// so vertices come out in world space.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 surface_normal;
+layout (location = 5) in vec4 chunk_transform; // translation, and uniform scale
+
+uniform mat4 vertex_world_to_clip;
+
+out vec3 normal;
+out vec3 vertex;
+
+void main()
+{
+	vertex = chunk_transform.xyz + chunk_transform.w * position;
+	normal = surface_normal;
+	gl_Position = vertex_world_to_clip * vec4(vertex, 1.0);
+}
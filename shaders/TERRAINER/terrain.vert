@@ -0,0 +1,17 @@
+#version 410
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 surface_normal;
+
+uniform mat4 vertex_model_to_world;
+uniform mat4 vertex_world_to_clip;
+
+out vec3 normal;
+out vec3 vertex;
+
+void main()
+{
+	vertex = position;
+	normal = surface_normal;
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(position, 1.0);
+}
@@ -0,0 +1,83 @@
+#include "draw_list.hpp"
+#include "node.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+// Only texture objects are compared, as sampler uniforms get set for every
+// draw anyway.
+bool
+DrawList::textures_less(Node const& a, Node const& b)
+{
+	return std::lexicographical_compare(a._textures.begin(), a._textures.end(), b._textures.begin(), b._textures.end(),
+	                                    [](Node::texture const& lhs, Node::texture const& rhs) {
+		return std::get<1>(lhs) < std::get<1>(rhs);
+	});
+}
+
+DrawList::DrawList() : _items(), _sorted(), _bound_textures(), _state_changes_nb(0u)
+{
+}
+
+void
+DrawList::add(Node const& node, glm::mat4 const& world, GLuint program, std::function<void (GLuint)> const& set_uniforms)
+{
+	if (node._vao == 0u || program == 0u)
+		return;
+
+	_items.push_back({ &node, world, program, set_uniforms });
+}
+
+void
+DrawList::flush(glm::mat4 const& WVP)
+{
+	_state_changes_nb = 0u;
+	if (_items.empty())
+		return;
+
+	_sorted.clear();
+	for (auto const& item : _items)
+		_sorted.push_back(&item);
+	std::stable_sort(_sorted.begin(), _sorted.end(), [](draw_item const* a, draw_item const* b) {
+		if (a->program != b->program)
+			return a->program < b->program;
+		if (textures_less(*a->node, *b->node))
+			return true;
+		if (textures_less(*b->node, *a->node))
+			return false;
+		return a->node->_vao < b->node->_vao;
+	});
+
+	GLuint program = 0u;
+	GLuint vao = 0u;
+	_bound_textures.clear();
+	for (auto const* item : _sorted) {
+		auto const& node = *item->node;
+
+		if (item->program != program) {
+			program = item->program;
+			glUseProgram(program);
+			++_state_changes_nb;
+		}
+		item->set_uniforms(program);
+
+		if (node.bind(program, WVP, item->world, &_bound_textures))
+			++_state_changes_nb;
+
+		if (node._vao != vao) {
+			vao = node._vao;
+			glBindVertexArray(vao);
+			++_state_changes_nb;
+		}
+		if (node._has_indices)
+			glDrawElements(node._drawing_mode, node._indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+		else if (node._transform_feedback != 0u)
+			glDrawTransformFeedback(node._drawing_mode, node._transform_feedback);
+		else
+			glDrawArrays(node._drawing_mode, 0, node._vertices_nb);
+	}
+	glBindVertexArray(0u);
+	glUseProgram(0u);
+
+	_items.clear();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class Node;
+
+//! \brief Collects the draws of many nodes, and issues them sorted by
+//!        program, textures and vertex array, so that state shared by
+//!        consecutive draws is only set once.
+//!
+//! Queued nodes must stay alive and unchanged until `flush()` is called.
+class DrawList
+{
+public:
+	//! \brief Default constructor.
+	DrawList();
+
+	//! \brief Queue a node for drawing.
+	//!
+	//! @param [in] node the node to draw
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms specific to this node
+	void add(Node const& node, glm::mat4 const& world, GLuint program,
+	         std::function<void (GLuint)> const& set_uniforms);
+
+	//! \brief Issue all queued draws, then empty the list.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space
+	void flush(glm::mat4 const& WVP);
+
+	//! \brief Return the number of queued draws.
+	size_t get_items_nb() const { return _items.size(); }
+
+	//! \brief Return the number of programs, texture sets and vertex
+	//!        arrays bound during the latest call to `flush()`.
+	size_t get_state_changes_nb() const { return _state_changes_nb; }
+
+private:
+	struct draw_item {
+		Node const* node;
+		glm::mat4 world;
+		GLuint program;
+		std::function<void (GLuint)> set_uniforms;
+	};
+
+	static bool textures_less(Node const& a, Node const& b);
+
+	std::vector<draw_item> _items;
+	std::vector<draw_item const*> _sorted;
+	std::vector<std::pair<GLenum, GLuint>> _bound_textures; // by texture unit
+	size_t _state_changes_nb;
+};
@@ -1,5 +1,6 @@
 #include "config.hpp"
 #include "helpers.hpp"
+#include "mesh_cache.hpp"
 
 #include "core/Log.h"
 #include "core/Misc.h"
@@ -12,6 +13,7 @@
 #include <assimp/postprocess.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cassert>
 
 namespace local
@@ -36,193 +38,61 @@ eda221::deinit()
 	glDeleteVertexArrays(1, &local::display_vao);
 }
 
+// Logging is not thread-safe, and `decodeTexture2D()` runs this on worker
+// threads: failures are described in `error` instead.
 static std::vector<u8>
-getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
+decodeImage(std::string const& path, u32& width, u32& height, bool flip, std::string& error)
 {
-	auto const path = config::resources_path(filename);
 	std::vector<unsigned char> image;
 	if (lodepng::decode(image, width, height, path, LCT_RGBA) != 0) {
-		LogWarning("Couldn't load or decode image file %s", path.c_str());
+		error = "Couldn't load or decode image file " + path;
 		return image;
 	}
 	if (!flip)
 		return image;
 
 	auto const channels_nb = 4u;
-	auto flipBuffer = std::vector<u8>(width * height * channels_nb);
-	for (u32 y = 0; y < height; y++)
-		memcpy(flipBuffer.data() + (height - 1 - y) * width * channels_nb, &image[y * width * channels_nb], width * channels_nb);
+	auto const row_size = width * channels_nb;
+	for (u32 y = 0; y < height / 2u; y++)
+		std::swap_ranges(image.begin() + y * row_size, image.begin() + (y + 1u) * row_size, image.begin() + (height - 1u - y) * row_size);
+
+	return image;
+}
 
-	return flipBuffer;
+static std::vector<u8>
+getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
+{
+	std::string error;
+	auto image = decodeImage(config::resources_path(filename), width, height, flip, error);
+	if (!error.empty())
+		LogWarning("%s", error.c_str());
+	return image;
 }
 
 std::vector<eda221::mesh_data>
 eda221::loadObjects(std::string const& filename)
 {
-	std::vector<eda221::mesh_data> objects;
-
 	auto const scene_filepath = config::resources_path("scenes/" + filename);
 	LogInfo("Loading \"%s\"", scene_filepath.c_str());
-	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(scene_filepath, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
-	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
-		LogError("Assimp failed to load \"%s\": %s", scene_filepath.c_str(), importer.GetErrorString());
-		return objects;
-	}
-
-	if (assimp_scene->mNumMeshes == 0u) {
-		LogError("No mesh available; loading \"%s\" must have had issues", scene_filepath.c_str());
-		return objects;
-	}
-
-	std::vector<texture_bindings> materials_bindings;
-	materials_bindings.reserve(assimp_scene->mNumMaterials);
-
-	LogInfo("\t* materials");
-	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		texture_bindings bindings;
-		auto const material = assimp_scene->mMaterials[i];
-
-		auto const process_texture = [&bindings,&material,i](aiTextureType type, std::string const& type_as_str, std::string const& name){
-			if (material->GetTextureCount(type)) {
-				if (material->GetTextureCount(type) > 1)
-					LogWarning("Material %d has more than one %s texture: discarding all but the first one.", i, type_as_str.c_str());
-				aiString path;
-				material->GetTexture(type, 0, &path);
-				auto const id = eda221::loadTexture2D("../crysponza/" + std::string(path.C_Str()), type_as_str != "opacity");
-				if (id != 0u)
-					bindings.emplace(name, id);
-			}
-		};
-
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
-
-		materials_bindings.push_back(bindings);
-	}
-
-	LogInfo("\t* meshes");
-	objects.reserve(assimp_scene->mNumMeshes);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
-
-		if (!assimp_object_mesh->HasFaces()) {
-			LogError("Unsupported object \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
-			LogError("Unsupported object \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
-			continue;
+	eda221::MeshCache cache(scene_filepath);
+	if (!cache.is_loaded()) {
+		Assimp::Importer importer;
+		auto const assimp_scene = importer.ReadFile(scene_filepath, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
+		if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
+			LogError("Assimp failed to load \"%s\": %s", scene_filepath.c_str(), importer.GetErrorString());
+			return std::vector<eda221::mesh_data>();
 		}
-		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
-			LogError("Unsupported object \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if (!assimp_object_mesh->HasPositions()) {
-			LogError("Unsupported object \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-
-		eda221::mesh_data object;
-
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
-
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
-
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
-
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
-
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
-
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
-
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+		if (assimp_scene->mNumMeshes == 0u) {
+			LogError("No mesh available; loading \"%s\" must have had issues", scene_filepath.c_str());
+			return std::vector<eda221::mesh_data>();
 		}
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-		}
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face >= 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face >= 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
-		glGenBuffers(1, &object.ibo);
-		assert(object.ibo != 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
-
-		glBindVertexArray(0u);
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= materials_bindings.size())
-			LogError("Object \"%s\" has a material index of %u, but only %u materials were retrieved.", assimp_object_mesh->mName.C_Str(), material_id, materials_bindings.size());
-		else
-			object.bindings = materials_bindings[material_id];
-
-		objects.push_back(object);
-
-//		LogInfo("Loaded object \"%s\" with normals:%d, tangents&bitangents:%d, texcoords:%d",
-//		        assimp_object_mesh->mName.C_Str(), assimp_object_mesh->HasNormals(),
-//		        assimp_object_mesh->HasTangentsAndBitangents(), assimp_object_mesh->HasTextureCoords(0));
+		if (!cache.build(*assimp_scene))
+			return std::vector<eda221::mesh_data>();
 	}
 
-	return objects;
+	return cache.upload();
 }
 
 GLuint
@@ -258,15 +128,24 @@ eda221::create_table_tex(uint32_t width, uint32_t height, GLenum target, GLint i
 	return texture;
 }
 
+eda221::image_data
+eda221::decodeTexture2D(std::string const& filename)
+{
+	eda221::image_data image;
+	image.texels = decodeImage(config::resources_path("textures/" + filename), image.width, image.height, true, image.error);
+	return image;
+}
+
 GLuint
-eda221::loadTexture2D(std::string const& filename, bool generate_mipmap)
+eda221::uploadTexture2D(eda221::image_data const& image, bool generate_mipmap)
 {
-	u32 width, height;
-	auto const data = getTextureData("textures/" + filename, width, height, true);
-	if (data.empty())
+	if (image.texels.empty()) {
+		if (!image.error.empty())
+			LogWarning("%s", image.error.c_str());
 		return 0u;
+	}
 
-	GLuint texture = eda221::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
+	GLuint texture = eda221::createTexture(image.width, image.height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(image.texels.data()));
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -277,6 +156,12 @@ eda221::loadTexture2D(std::string const& filename, bool generate_mipmap)
 	return texture;
 }
 
+GLuint
+eda221::loadTexture2D(std::string const& filename, bool generate_mipmap)
+{
+	return eda221::uploadTexture2D(eda221::decodeTexture2D(filename), generate_mipmap);
+}
+
 GLuint
 eda221::loadTextureCubeMap(std::string const& posx, std::string const& negx,
                            std::string const& posy, std::string const& negy,
@@ -370,6 +255,25 @@ eda221::createProgram(std::string const& vert_shader_source_path, std::string co
 	return program;
 }
 
+GLuint
+eda221::createProgram(std::string const& base_dir, std::string const& vert_shader_source_path, std::string const& frag_shader_source_path)
+{
+	auto const vertex_shader_source = utils::slurp_file(config::shaders_path(base_dir + vert_shader_source_path));
+	GLuint vertex_shader = utils::opengl::shader::generate_shader(GL_VERTEX_SHADER, vertex_shader_source);
+	if (vertex_shader == 0u)
+		return 0u;
+
+	auto const fragment_shader_source = utils::slurp_file(config::shaders_path(base_dir + frag_shader_source_path));
+	GLuint fragment_shader = utils::opengl::shader::generate_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+	if (fragment_shader == 0u)
+		return 0u;
+
+	GLuint program = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader });
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+	return program;
+}
+
 GLuint
 eda221::createProgramWithGeo(std::string const& base_dir, std::string const& vert_shader_source_path, std::string const& geo_shader_source_path, std::string const& frag_shader_source_path)
 {
@@ -396,6 +300,37 @@ eda221::createProgramWithGeo(std::string const& base_dir, std::string const& ver
 }
 
 
+GLuint
+eda221::createTransformFeedbackProgram(std::string const& base_dir, std::string const& vert_shader_source_path, std::string const& geo_shader_source_path, std::vector<std::string> const& varyings)
+{
+	auto const vertex_shader_source = utils::slurp_file(config::shaders_path(base_dir + vert_shader_source_path));
+	GLuint vertex_shader = utils::opengl::shader::generate_shader(GL_VERTEX_SHADER, vertex_shader_source);
+	if (vertex_shader == 0u)
+		return 0u;
+
+	auto const geo_shader_source = utils::slurp_file(config::shaders_path(base_dir + geo_shader_source_path));
+	GLuint geo_shader = utils::opengl::shader::generate_shader(GL_GEOMETRY_SHADER, geo_shader_source);
+	if (geo_shader == 0u)
+		return 0u;
+
+	// The varyings have to be specified before linking, so the program
+	// can not go through `generate_program()`.
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, geo_shader);
+	auto varyings_c_str = std::vector<GLchar const*>();
+	varyings_c_str.reserve(varyings.size());
+	for (auto const& varying : varyings)
+		varyings_c_str.push_back(varying.c_str());
+	glTransformFeedbackVaryings(program, static_cast<GLsizei>(varyings_c_str.size()), varyings_c_str.data(), GL_INTERLEAVED_ATTRIBS);
+	if (!utils::opengl::shader::link_program(program)) {
+		glDeleteProgram(program);
+		program = 0u;
+	}
+	glDeleteShader(vertex_shader);
+	glDeleteShader(geo_shader);
+	return program;
+}
 
 void
 eda221::displayTexture(glm::vec2 const& lower_left, glm::vec2 const& upper_right, GLuint texture, GLuint sampler, glm::ivec4 const& swizzle, glm::ivec2 const& window_size, FPSCameraf const* camera)
@@ -37,8 +37,9 @@ namespace eda221
 		size_t indices_nb;         //!< number of indices stored in ibo
 		texture_bindings bindings; //!< texture bindings for this mesh
 		GLenum drawing_mode;       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
+		GLuint transform_feedback; //!< OpenGL name of the Transform Feedback Object that captured bo, if any; then drawn with glDrawTransformFeedback() rather than vertices_nb
 
-		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), bindings(), drawing_mode(GL_TRIANGLES)
+		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), bindings(), drawing_mode(GL_TRIANGLES), transform_feedback(0u)
 		{
 		}
 	};
@@ -51,6 +52,9 @@ namespace eda221
 
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
+	//! The converted objects are saved in a binary cache next to the file,
+	//! which later loads use instead, until the file gets modified.
+	//!
 	//! @param [in] filename of the object/scene file to load, relative to
 	//!             the `res/scenes` folder
 	//! @return a vector of filled in `mesh_data` structures, one per
@@ -79,6 +83,38 @@ namespace eda221
 	GLuint create_table_tex(uint32_t width, uint32_t height,
 							GLenum target, GLint internal, GLenum format, int *data);
 
+	//! \brief Contains the texels of an image decoded on the CPU.
+	struct image_data {
+		std::vector<unsigned char> texels; //!< RGBA texels, bottom row first; empty if decoding failed
+		uint32_t width;                    //!< width of the image, in texels
+		uint32_t height;                   //!< height of the image, in texels
+		std::string error;                 //!< why decoding failed, empty if it did not
+
+		image_data() : texels(), width(0u), height(0u), error()
+		{
+		}
+	};
+
+	//! \brief Decode a PNG image, without making any OpenGL call nor
+	//!        logging anything; it can therefore be called from any
+	//!        thread. A failure is described in the returned image, and
+	//!        logged by `uploadTexture2D()`.
+	//!
+	//! @param [in] filename of the PNG image, relative to the `textures`
+	//!             folder within the `resources` folder.
+	//! @return the decoded image, flipped to match OpenGL's texture
+	//!         coordinates
+	image_data decodeTexture2D(std::string const& filename);
+
+	//! \brief Upload a decoded image into an OpenGL 2D-texture.
+	//!
+	//! @param [in] image the image returned by `decodeTexture2D()`
+	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @return the name of the OpenGL 2D-texture, or 0 if the image is
+	//!         empty, after logging why decoding failed
+	GLuint uploadTexture2D(image_data const& image,
+	                       bool generate_mipmap = true);
+
 	//! \brief Load a PNG image into an OpenGL 2D-texture.
 	//!
 	//! @param [in] filename of the PNG image, relative to the `textures`
@@ -119,8 +155,40 @@ namespace eda221
 	GLuint createProgram(std::string const& vert_shader_source_path,
 	                     std::string const& frag_shader_source_path);
 
+	//! \brief Create an OpenGL program consisting of a vertex and a
+	//!        fragment shader, found in a given shader folder.
+	//!
+	//! @param [in] base_dir folder containing the shaders, relative to the
+	//!             `shaders` folder and ending with a slash
+	//! @param [in] vert_shader_source_path of the vertex shader source
+	//!             code, relative to `base_dir`
+	//! @param [in] frag_shader_source_path of the fragment shader source
+	//!             code, relative to `base_dir`
+	//! @return the name of the OpenGL shader program
+	GLuint createProgram(std::string const& base_dir,
+	                     std::string const& vert_shader_source_path,
+	                     std::string const& frag_shader_source_path);
+
 	GLuint createProgramWithGeo(std::string const& base_dir, std::string const& vert_shader_source_path, std::string const& geo_shader_source_path,
 	                     std::string const& frag_shader_source_path);
+
+	//! \brief Create an OpenGL program consisting of a vertex and a
+	//!        geometry shader, whose outputs are captured using transform
+	//!        feedback rather than rasterised.
+	//!
+	//! @param [in] base_dir folder containing the shaders, relative to the
+	//!             `shaders` folder and ending with a slash
+	//! @param [in] vert_shader_source_path of the vertex shader source
+	//!             code, relative to `base_dir`
+	//! @param [in] geo_shader_source_path of the geometry shader source
+	//!             code, relative to `base_dir`
+	//! @param [in] varyings names of the geometry shader outputs to
+	//!             capture, interleaved in the given order
+	//! @return the name of the OpenGL shader program
+	GLuint createTransformFeedbackProgram(std::string const& base_dir,
+	                                      std::string const& vert_shader_source_path,
+	                                      std::string const& geo_shader_source_path,
+	                                      std::vector<std::string> const& varyings);
 	//! \brief Display the current texture in the specified rectangle.
 	//!
 	//! @param [in] lower_left the lower left corner of the rectangle
@@ -0,0 +1,482 @@
+#include "mesh_cache.hpp"
+
+#include "core/Log.h"
+#include "core/ThreadPool.h"
+
+#include <assimp/scene.h>
+
+#include <cassert>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <map>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace local
+{
+	static u8 const magic[4] = { 'E', 'M', 'C', '\0' };
+
+	// One per `eda221::shader_bindings`, each stored as three floats.
+	static u32 const attributes_nb = 5u;
+	static size_t const attribute_size = 3u * sizeof(float);
+
+	// Same order as `eda221::MeshCache::material_view`.
+	static aiTextureType const texture_types[4] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_NORMALS, aiTextureType_OPACITY };
+	static char const* const texture_names[4] = { "diffuse", "specular", "normals", "opacity" };
+	static char const* const samplers[4] = { "diffuse_texture", "specular_texture", "normals_texture", "opacity_texture" };
+	static size_t const opacity_texture = 3u;
+
+	// Reads 4-byte aligned fields out of a cache, checking that they fit.
+	class reader
+	{
+	public:
+		reader(u8 const* data, size_t size) : _data(data), _size(size), _offset(0u)
+		{
+		}
+
+		u8 const* read(size_t size)
+		{
+			auto const padded_size = (size + 3u) / 4u * 4u;
+			if (padded_size > _size - _offset)
+				return nullptr;
+			auto const data = _data + _offset;
+			_offset += padded_size;
+			return data;
+		}
+
+		bool read_u32(u32& value)
+		{
+			auto const data = read(sizeof(u32));
+			if (data == nullptr)
+				return false;
+			std::memcpy(&value, data, sizeof(u32));
+			return true;
+		}
+
+		size_t get_remaining() const { return _size - _offset; }
+
+	private:
+		u8 const* _data;
+		size_t _size;
+		size_t _offset;
+	};
+}
+
+constexpr u32 eda221::MeshCache::version;
+
+static u32
+getStride(u32 attributes)
+{
+	u32 stride = 0u;
+	for (u32 i = 0u; i < local::attributes_nb; ++i)
+		if ((attributes & (1u << i)) != 0u)
+			stride += static_cast<u32>(local::attribute_size);
+	return stride;
+}
+
+static bool
+getModificationTime(std::string const& path, time_t& time)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	time = info.st_mtime;
+	return true;
+}
+
+static u8 const*
+mapFile(std::string const& path, size_t& size)
+{
+#ifdef _WIN32
+	auto const file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	void const* data = nullptr;
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		// The view keeps the mapping, and the file, open.
+		auto const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+		if (mapping != nullptr) {
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0u, 0u, 0u);
+			CloseHandle(mapping);
+		}
+		size = static_cast<size_t>(file_size.QuadPart);
+	}
+	CloseHandle(file);
+	return static_cast<u8 const*>(data);
+#else
+	auto const fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	void* data = MAP_FAILED;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		// The mapping keeps the file open.
+		size = static_cast<size_t>(info.st_size);
+		data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	return data == MAP_FAILED ? nullptr : static_cast<u8 const*>(data);
+#endif
+}
+
+static void
+unmapFile(u8 const* data, size_t size)
+{
+#ifdef _WIN32
+	(void) size;
+	UnmapViewOfFile(data);
+#else
+	munmap(const_cast<u8*>(data), size);
+#endif
+}
+
+static void
+append(std::vector<u8>& bytes, void const* data, size_t size)
+{
+	auto const offset = bytes.size();
+	bytes.resize(offset + (size + 3u) / 4u * 4u, 0u);
+	if (size > 0u)
+		std::memcpy(bytes.data() + offset, data, size);
+}
+
+static void
+appendU32(std::vector<u8>& bytes, u32 value)
+{
+	append(bytes, &value, sizeof(value));
+}
+
+eda221::MeshCache::MeshCache(std::string const& scene_filepath) : _cache_filepath(scene_filepath + ".cache"), _built(), _data(nullptr), _size(0u), _is_mapped(false), _materials(), _meshes()
+{
+	time_t cache_time, scene_time;
+	if (!getModificationTime(_cache_filepath, cache_time))
+		return;
+	if (getModificationTime(scene_filepath, scene_time) && cache_time < scene_time) {
+		LogInfo("\"%s\" is older than its scene: rebuilding it", _cache_filepath.c_str());
+		return;
+	}
+
+	_data = mapFile(_cache_filepath, _size);
+	if (_data == nullptr) {
+		LogWarning("Failed to map \"%s\"", _cache_filepath.c_str());
+		return;
+	}
+	_is_mapped = true;
+
+	if (!parse()) {
+		LogWarning("\"%s\" is invalid or of another version: rebuilding it", _cache_filepath.c_str());
+		unmap();
+		return;
+	}
+	LogInfo("Loading from \"%s\"", _cache_filepath.c_str());
+}
+
+eda221::MeshCache::~MeshCache()
+{
+	unmap();
+}
+
+bool
+eda221::MeshCache::build(aiScene const& scene)
+{
+	static_assert(sizeof(aiVector3D) == local::attribute_size, "assimp vectors are expected to hold three floats");
+
+	unmap();
+
+	std::vector<u8> bytes;
+	append(bytes, local::magic, sizeof(local::magic));
+	appendU32(bytes, version);
+	appendU32(bytes, scene.mNumMaterials);
+	auto const meshes_nb_offset = bytes.size();
+	appendU32(bytes, 0u);
+
+	LogInfo("\t* materials");
+	for (unsigned int i = 0u; i < scene.mNumMaterials; ++i) {
+		auto const material = scene.mMaterials[i];
+		for (size_t t = 0u; t < 4u; ++t) {
+			auto const type = local::texture_types[t];
+			aiString path;
+			if (material->GetTextureCount(type) > 0u) {
+				if (material->GetTextureCount(type) > 1u)
+					LogWarning("Material %u has more than one %s texture: discarding all but the first one.", i, local::texture_names[t]);
+				material->GetTexture(type, 0u, &path);
+			}
+			appendU32(bytes, static_cast<u32>(path.length));
+			append(bytes, path.C_Str(), path.length);
+		}
+	}
+
+	LogInfo("\t* meshes");
+	u32 meshes_nb = 0u;
+	for (unsigned int j = 0u; j < scene.mNumMeshes; ++j) {
+		auto const assimp_object_mesh = scene.mMeshes[j];
+
+		if (!assimp_object_mesh->HasFaces()) {
+			LogError("Unsupported object \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
+		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
+		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
+			LogError("Unsupported object \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
+			LogError("Unsupported object \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if (!assimp_object_mesh->HasPositions()) {
+			LogError("Unsupported object \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+
+		auto const has_normals = assimp_object_mesh->HasNormals();
+		auto const has_texcoords = assimp_object_mesh->HasTextureCoords(0u);
+		auto const has_tangents = assimp_object_mesh->HasTangentsAndBitangents();
+		u32 attributes = 1u << static_cast<u32>(shader_bindings::vertices);
+		if (has_normals)
+			attributes |= 1u << static_cast<u32>(shader_bindings::normals);
+		if (has_texcoords)
+			attributes |= 1u << static_cast<u32>(shader_bindings::texcoords);
+		if (has_tangents)
+			attributes |= (1u << static_cast<u32>(shader_bindings::tangents)) | (1u << static_cast<u32>(shader_bindings::binormals));
+		auto const stride = getStride(attributes);
+
+		auto const vertices_nb = assimp_object_mesh->mNumVertices;
+		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+		auto const indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
+		appendU32(bytes, attributes);
+		appendU32(bytes, stride);
+		appendU32(bytes, vertices_nb);
+		appendU32(bytes, indices_nb);
+		appendU32(bytes, assimp_object_mesh->mMaterialIndex);
+
+		auto const vertices_offset = bytes.size();
+		bytes.resize(vertices_offset + static_cast<size_t>(vertices_nb) * stride);
+		auto vertex = bytes.data() + vertices_offset;
+		auto const write = [&vertex](aiVector3D const& v){
+			std::memcpy(vertex, &v, local::attribute_size);
+			vertex += local::attribute_size;
+		};
+		for (unsigned int v = 0u; v < vertices_nb; ++v) {
+			write(assimp_object_mesh->mVertices[v]);
+			if (has_normals)
+				write(assimp_object_mesh->mNormals[v]);
+			if (has_texcoords)
+				write(assimp_object_mesh->mTextureCoords[0u][v]);
+			if (has_tangents) {
+				write(assimp_object_mesh->mTangents[v]);
+				write(assimp_object_mesh->mBitangents[v]);
+			}
+		}
+
+		auto const indices_offset = bytes.size();
+		bytes.resize(indices_offset + static_cast<size_t>(indices_nb) * sizeof(GLuint));
+		auto index = bytes.data() + indices_offset;
+		for (unsigned int i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+			auto const& face = assimp_object_mesh->mFaces[i];
+			assert(face.mNumIndices == num_vertices_per_face);
+			std::memcpy(index, face.mIndices, num_vertices_per_face * sizeof(GLuint));
+			index += num_vertices_per_face * sizeof(GLuint);
+		}
+
+		++meshes_nb;
+	}
+	std::memcpy(bytes.data() + meshes_nb_offset, &meshes_nb, sizeof(meshes_nb));
+
+	if (meshes_nb == 0u) {
+		LogError("No mesh could be converted");
+		return false;
+	}
+
+	// A partially written cache fails to parse on the next load, and gets
+	// rebuilt then.
+	std::ofstream file(_cache_filepath, std::ios::binary | std::ios::trunc);
+	if (!file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+		LogWarning("Failed to write \"%s\"", _cache_filepath.c_str());
+
+	_built.swap(bytes);
+	_data = _built.data();
+	_size = _built.size();
+	if (!parse()) {
+		unmap();
+		return false;
+	}
+	return true;
+}
+
+std::vector<eda221::mesh_data>
+eda221::MeshCache::upload() const
+{
+	std::vector<eda221::mesh_data> objects;
+
+	// Decode every distinct texture on the workers, while the meshes get
+	// uploaded; only the texture uploads are left to this thread.
+	struct texture_load {
+		std::future<image_data> image;
+		bool is_used[2];  // without and with mipmaps
+		GLuint ids[2];
+
+		texture_load() : image(), is_used{false, false}, ids{0u, 0u}
+		{
+		}
+	};
+	std::map<std::string, texture_load> textures;
+	for (auto const& material : _materials) {
+		for (size_t t = 0u; t < material.size(); ++t) {
+			if (material[t].empty())
+				continue;
+			auto& texture = textures[material[t]];
+			texture.is_used[t != local::opacity_texture ? 1u : 0u] = true;
+		}
+	}
+	ThreadPool workers;
+	for (auto& texture : textures) {
+		auto const& path = texture.first;
+		texture.second.image = workers.Enqueue([path](){
+			return eda221::decodeTexture2D("../crysponza/" + path);
+		});
+	}
+
+	objects.reserve(_meshes.size());
+	for (auto const& mesh : _meshes) {
+		eda221::mesh_data object;
+
+		glGenVertexArrays(1, &object.vao);
+		assert(object.vao != 0u);
+		glBindVertexArray(object.vao);
+
+		glGenBuffers(1, &object.bo);
+		assert(object.bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(static_cast<size_t>(mesh.vertices_nb) * mesh.stride), reinterpret_cast<GLvoid const*>(mesh.vertices), GL_STATIC_DRAW);
+
+		size_t offset = 0u;
+		for (u32 i = 0u; i < local::attributes_nb; ++i) {
+			if ((mesh.attributes & (1u << i)) == 0u)
+				continue;
+			glEnableVertexAttribArray(i);
+			glVertexAttribPointer(i, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(mesh.stride), reinterpret_cast<GLvoid const*>(offset));
+			offset += local::attribute_size;
+		}
+
+		glGenBuffers(1, &object.ibo);
+		assert(object.ibo != 0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(static_cast<size_t>(mesh.indices_nb) * sizeof(GLuint)), reinterpret_cast<GLvoid const*>(mesh.indices), GL_STATIC_DRAW);
+
+		glBindVertexArray(0u);
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+		object.vertices_nb = mesh.vertices_nb;
+		object.indices_nb = mesh.indices_nb;
+
+		objects.push_back(object);
+	}
+
+	// Textures are uploaded in the order they were queued in, and each
+	// image is released as soon as it is uploaded.
+	for (auto& texture : textures) {
+		auto const image = texture.second.image.get();
+		for (size_t m = 0u; m < 2u; ++m)
+			if (texture.second.is_used[m])
+				texture.second.ids[m] = eda221::uploadTexture2D(image, m == 1u);
+	}
+
+	std::vector<texture_bindings> materials_bindings;
+	materials_bindings.reserve(_materials.size());
+	for (auto const& material : _materials) {
+		texture_bindings bindings;
+		for (size_t t = 0u; t < material.size(); ++t) {
+			if (material[t].empty())
+				continue;
+			auto const id = textures[material[t]].ids[t != local::opacity_texture ? 1u : 0u];
+			if (id != 0u)
+				bindings.emplace(local::samplers[t], id);
+		}
+		materials_bindings.push_back(bindings);
+	}
+
+	for (size_t j = 0u; j < objects.size(); ++j) {
+		auto const material = _meshes[j].material;
+		if (material >= materials_bindings.size())
+			LogError("Object has a material index of %u, but only %u materials were retrieved.", material, static_cast<unsigned int>(materials_bindings.size()));
+		else
+			objects[j].bindings = materials_bindings[material];
+	}
+
+	return objects;
+}
+
+bool
+eda221::MeshCache::parse()
+{
+	_materials.clear();
+	_meshes.clear();
+
+	local::reader in(_data, _size);
+	auto const magic = in.read(sizeof(local::magic));
+	u32 cache_version, materials_nb, meshes_nb;
+	if (magic == nullptr || std::memcmp(magic, local::magic, sizeof(local::magic)) != 0
+	 || !in.read_u32(cache_version) || cache_version != version
+	 || !in.read_u32(materials_nb) || !in.read_u32(meshes_nb))
+		return false;
+
+	for (u32 i = 0u; i < materials_nb; ++i) {
+		material_view material;
+		for (auto& path : material) {
+			u32 length;
+			if (!in.read_u32(length))
+				return false;
+			auto const chars = in.read(length);
+			if (chars == nullptr)
+				return false;
+			path.assign(reinterpret_cast<char const*>(chars), length);
+		}
+		_materials.push_back(material);
+	}
+
+	for (u32 j = 0u; j < meshes_nb; ++j) {
+		mesh_view mesh;
+		if (!in.read_u32(mesh.attributes) || !in.read_u32(mesh.stride)
+		 || !in.read_u32(mesh.vertices_nb) || !in.read_u32(mesh.indices_nb)
+		 || !in.read_u32(mesh.material))
+			return false;
+		if ((mesh.attributes & (1u << static_cast<u32>(shader_bindings::vertices))) == 0u
+		 || (mesh.attributes >> local::attributes_nb) != 0u
+		 || mesh.stride != getStride(mesh.attributes))
+			return false;
+
+		mesh.vertices = in.read(static_cast<size_t>(mesh.vertices_nb) * mesh.stride);
+		auto const indices = in.read(static_cast<size_t>(mesh.indices_nb) * sizeof(GLuint));
+		if (mesh.vertices == nullptr || indices == nullptr)
+			return false;
+		mesh.indices = reinterpret_cast<GLuint const*>(indices);
+		_meshes.push_back(mesh);
+	}
+
+	return in.get_remaining() == 0u;
+}
+
+void
+eda221::MeshCache::unmap()
+{
+	if (_is_mapped)
+		unmapFile(_data, _size);
+	_is_mapped = false;
+	_built.clear();
+	_data = nullptr;
+	_size = 0u;
+	_materials.clear();
+	_meshes.clear();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include "core/Types.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct aiScene;
+
+namespace eda221
+{
+	//! \brief Binary copy of the meshes and material bindings of a scene
+	//!        file, stored next to it so that later loads can skip assimp.
+	//!
+	//! The cache is memory-mapped, and its vertices are stored interleaved
+	//! and in native byte order, so that they can be uploaded as is. It is
+	//! only used if it has the current `version` and is at least as recent
+	//! as the scene file.
+	class MeshCache
+	{
+	public:
+		//! \brief Version of the cache layout; caches of any other
+		//!        version are rebuilt.
+		static constexpr u32 version = 1u;
+
+		//! \brief Memory-map the cache of a scene, if it is up to date.
+		//!
+		//! @param [in] scene_filepath path to the scene file
+		MeshCache(std::string const& scene_filepath);
+
+		//! \brief Unmap the cache.
+		~MeshCache();
+
+		MeshCache(MeshCache const&) = delete;
+		MeshCache& operator=(MeshCache const&) = delete;
+
+		//! \brief Return whether a valid cache is available for upload.
+		bool is_loaded() const { return _data != nullptr; }
+
+		//! \brief Convert a scene loaded by assimp, and save it as the
+		//!        cache of the scene file.
+		//!
+		//! @param [in] scene scene loaded with `aiProcess_Triangulate`,
+		//!             `aiProcess_SortByPType` and
+		//!             `aiProcess_CalcTangentSpace`
+		//! @return whether at least one mesh could be converted; the
+		//!         cache can be uploaded even if it could not be saved
+		bool build(aiScene const& scene);
+
+		//! \brief Upload the meshes of the cache to OpenGL, and load the
+		//!        textures bound to them.
+		//!
+		//! @return a vector of filled in `mesh_data` structures, one per
+		//!         mesh in the cache
+		std::vector<mesh_data> upload() const;
+
+	private:
+		struct mesh_view {
+			u32 attributes;           // bit i set if shader_bindings i is stored
+			u32 stride;               // in bytes
+			u32 vertices_nb;
+			u32 indices_nb;
+			u32 material;
+			u8 const* vertices;       // interleaved, in shader_bindings order
+			GLuint const* indices;
+		};
+
+		using material_view = std::array<std::string, 4>; // diffuse, specular, normals and opacity texture paths, possibly empty
+
+		bool parse();
+		void unmap();
+
+		std::string _cache_filepath;
+		std::vector<u8> _built;     // content of the cache, when built rather than mapped
+		u8 const* _data;
+		size_t _size;
+		bool _is_mapped;
+		std::vector<material_view> _materials;
+		std::vector<mesh_view> _meshes;
+	};
+}
@@ -2,11 +2,12 @@
 #include "helpers.hpp"
 
 #include "core/Log.h"
+#include "core/opengl.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Node::Node() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_POINTS), _has_indices(true), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
+Node::Node() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_POINTS), _has_indices(true), _transform_feedback(0u), _program(0u), _textures(), _has_diffuse_texture(false), _has_opacity_texture(false), _locations(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
 {
 }
 
@@ -24,34 +25,16 @@ Node::render(glm::mat4 const& WVP, glm::mat4 const& world, GLuint program, std::
 
 	glUseProgram(program);
 
-	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
-
 	set_uniforms(program);
-
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(WVP));
-
-	glUniform1i(glGetUniformLocation(program, "has_textures"), !_textures.empty());
-	bool has_diffuse_texture = false, has_opacity_texture = false;
-	for (size_t i = 0u; i < _textures.size(); ++i) {
-		auto const texture = _textures[i];
-		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-		if (std::get<0>(texture) == "diffuse_texture")
-			has_diffuse_texture = true;
-		else if (std::get<0>(texture) == "opacity_texture")
-			has_opacity_texture = true;
-	}
-	glUniform1i(glGetUniformLocation(program, "has_diffuse_texture"), has_diffuse_texture);
-	glUniform1i(glGetUniformLocation(program, "has_opacity_texture"), has_opacity_texture);
+	bind(program, WVP, world, nullptr);
 
 	glBindVertexArray(_vao);
 	if (_has_indices) {
-		printf("using the indices");
 		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
 	}
+	else if (_transform_feedback != 0u) {
+		glDrawTransformFeedback(_drawing_mode, _transform_feedback);
+	}
 	else {
 		glDrawArrays(_drawing_mode, 0, _vertices_nb);
 	}
@@ -65,9 +48,10 @@ Node::set_geometry(eda221::mesh_data const& shape)
 {
 	_vao = shape.vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
-	_indices_nb = 0; //static_cast<GLsizei>(shape.indices_nb);
+	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
 	_drawing_mode = shape.drawing_mode;
-	_has_indices = false; //shape.ibo != 0u;
+	_has_indices = shape.ibo != 0u;
+	_transform_feedback = shape.transform_feedback;
 
 	if (!shape.bindings.empty()) {
 		for (auto const& binding : shape.bindings)
@@ -103,8 +87,14 @@ Node::set_has_indices(bool has_indices)
 void
 Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 {
-	if (tex_id != 0u)
-		_textures.emplace_back(name, tex_id, type);
+	if (tex_id == 0u)
+		return;
+
+	_textures.emplace_back(name, tex_id, type);
+	if (name == "diffuse_texture")
+		_has_diffuse_texture = true;
+	else if (name == "opacity_texture")
+		_has_opacity_texture = true;
 }
 
 void
@@ -152,6 +142,57 @@ Node::scale(glm::vec3 const& s)
 	_scaling *= s;
 }
 
+void
+Node::update_locations(GLuint program) const
+{
+	auto const link_id = utils::opengl::shader::get_link_id(program);
+	if (program == _locations.program && link_id == _locations.link_id && _locations.textures.size() == _textures.size())
+		return;
+
+	_locations.program = program;
+	_locations.link_id = link_id;
+	_locations.vertex_model_to_world = glGetUniformLocation(program, "vertex_model_to_world");
+	_locations.normal_model_to_world = glGetUniformLocation(program, "normal_model_to_world");
+	_locations.vertex_world_to_clip = glGetUniformLocation(program, "vertex_world_to_clip");
+	_locations.has_textures = glGetUniformLocation(program, "has_textures");
+	_locations.has_diffuse_texture = glGetUniformLocation(program, "has_diffuse_texture");
+	_locations.has_opacity_texture = glGetUniformLocation(program, "has_opacity_texture");
+	_locations.textures.clear();
+	for (auto const& texture : _textures)
+		_locations.textures.push_back(glGetUniformLocation(program, std::get<0>(texture).c_str()));
+}
+
+bool
+Node::bind(GLuint program, glm::mat4 const& WVP, glm::mat4 const& world,
+           std::vector<std::pair<GLenum, GLuint>>* bound_textures) const
+{
+	update_locations(program);
+	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+	glUniformMatrix4fv(_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(_locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+	glUniformMatrix4fv(_locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(WVP));
+
+	glUniform1i(_locations.has_textures, !_textures.empty());
+	if (bound_textures != nullptr && bound_textures->size() < _textures.size())
+		bound_textures->resize(_textures.size(), std::make_pair(GL_NONE, 0u));
+	auto textures_changed = false;
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		auto const binding = std::make_pair(std::get<2>(_textures[i]), std::get<1>(_textures[i]));
+		if (bound_textures == nullptr || (*bound_textures)[i] != binding) {
+			glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+			glBindTexture(binding.first, binding.second);
+			if (bound_textures != nullptr)
+				(*bound_textures)[i] = binding;
+			textures_changed = true;
+		}
+		glUniform1i(_locations.textures[i], static_cast<GLint>(i));
+	}
+	glUniform1i(_locations.has_diffuse_texture, _has_diffuse_texture);
+	glUniform1i(_locations.has_opacity_texture, _has_opacity_texture);
+
+	return textures_changed;
+}
+
 glm::mat4x4
 Node::get_transform() const
 {
@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 namespace eda221
@@ -167,19 +168,48 @@ public:
 	glm::mat4x4 get_transform() const;
 
 private:
+	friend class DrawList;
+
 	// Geometry data
 	GLuint _vao;
 	GLsizei _vertices_nb;
 	GLsizei _indices_nb;
 	GLenum _drawing_mode;
 	bool _has_indices;
+	GLuint _transform_feedback;
 
 	// Program data
 	GLuint _program;
 	std::function<void (GLuint)> _set_uniforms;
 
-	// Textures data
-	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+	// Textures data, as (sampler name, texture, target)
+	using texture = std::tuple<std::string, GLuint, GLenum>;
+	std::vector<texture> _textures;
+	bool _has_diffuse_texture;
+	bool _has_opacity_texture;
+
+	// Uniform locations in the program last rendered with, looked up again
+	// whenever another program, or a new link of it, gets used
+	struct uniform_locations {
+		GLuint program;
+		size_t link_id;
+		GLint vertex_model_to_world;
+		GLint normal_model_to_world;
+		GLint vertex_world_to_clip;
+		GLint has_textures;
+		GLint has_diffuse_texture;
+		GLint has_opacity_texture;
+		std::vector<GLint> textures;
+	};
+	void update_locations(GLuint program) const;
+	mutable uniform_locations _locations;
+
+	// Set the transforms and texture uniforms of the program in use, and
+	// bind the textures to the units following their order. Units already
+	// holding the right texture in `bound_textures`, if given, are left
+	// alone, and it is kept up to date. Return whether a texture got bound.
+	bool bind(GLuint program, glm::mat4 const& WVP, glm::mat4 const& world,
+	          std::vector<std::pair<GLenum, GLuint>>* bound_textures) const;
 
 	// Transformation data
 	glm::vec3 _scaling;
@@ -281,7 +281,7 @@ parametric_shapes::create_cube(unsigned int cube_size)
 	                      0,
 	                      reinterpret_cast<GLvoid const*>(0x0));
 
-	data.vertices_nb = vertices.size() * 3u;
+	data.vertices_nb = vertices.size();
 
 	// All the data has been recorded, we can unbind them.
 	glBindVertexArray(0u);
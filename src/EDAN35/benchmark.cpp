@@ -0,0 +1,191 @@
+#include "benchmark.hpp"
+
+#include "core/Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+
+namespace constant
+{
+    constexpr float benchmark_path_radius  = 120.0f; // world units
+    constexpr float benchmark_path_height  = 6.0f;
+    constexpr float benchmark_path_bobbing = 3.0f;
+    constexpr float two_pi                 = 6.28318530718f;
+}
+
+constexpr size_t edan35::Benchmark::frames_in_flight;
+
+// Counters the driver could not provide are left empty.
+static void
+write_counter(std::ostream& stream, GLint64 value, char const* missing)
+{
+    if (value < 0)
+        stream << missing;
+    else
+        stream << value;
+}
+
+static bool
+ends_with(std::string const& str, std::string const& suffix)
+{
+    return str.size() >= suffix.size()
+        && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+edan35::Benchmark::Benchmark(size_t frames_nb)
+    : _frames_nb(frames_nb), _frame(0u), _times(), _counters(), _queries()
+{
+    _times.reserve(frames_nb);
+    _counters.reserve(frames_nb);
+    glGenQueries(static_cast<GLsizei>(_queries.size()), _queries.data());
+    for (auto const query : _queries)
+        assert(query != 0u);
+}
+
+edan35::Benchmark::~Benchmark()
+{
+    glDeleteQueries(static_cast<GLsizei>(_queries.size()), _queries.data());
+    _queries.fill(0u);
+}
+
+void
+edan35::Benchmark::move_camera(FPSCameraf& camera) const
+{
+    // One loop around the origin, going up and down a few times, so that
+    // chunks get loaded, change level of detail and get evicted.
+    auto const t = static_cast<float>(_frame) / static_cast<float>(std::max<size_t>(_frames_nb, 1u));
+    auto const angle = constant::two_pi * t;
+    auto const position = glm::vec3(constant::benchmark_path_radius * std::sin(angle),
+                                    constant::benchmark_path_height + constant::benchmark_path_bobbing * std::sin(3.0f * angle),
+                                    constant::benchmark_path_radius * (1.0f - std::cos(angle)));
+    auto const direction = glm::vec3(std::cos(angle), -0.2f, std::sin(angle));
+
+    camera.mWorld.SetTranslate(position);
+    camera.mWorld.LookTowards(direction);
+}
+
+void
+edan35::Benchmark::begin_frame()
+{
+    auto const slot = _frame % frames_in_flight;
+    // The frame which used these queries last is a few frames old: their
+    // results are most likely available already.
+    if (_frame >= frames_in_flight)
+        read_gpu_time(_frame - frames_in_flight);
+    glQueryCounter(_queries[2u * slot], GL_TIMESTAMP);
+}
+
+void
+edan35::Benchmark::end_frame(double cpu_time)
+{
+    glQueryCounter(_queries[2u * (_frame % frames_in_flight) + 1u], GL_TIMESTAMP);
+    _times.push_back({ cpu_time, -1.0 });
+    ++_frame;
+}
+
+void
+edan35::Benchmark::set_counters(pipeline_counters const& counters)
+{
+    // Counters are collected right after the frame is drawn, so they can
+    // come before end_frame() records it.
+    if (counters.frame >= _frames_nb)
+        return;
+    if (counters.frame >= _counters.size())
+        _counters.resize(counters.frame + 1u);
+    _counters[counters.frame] = counters;
+}
+
+bool
+edan35::Benchmark::is_done() const
+{
+    return _frame >= _frames_nb;
+}
+
+bool
+edan35::Benchmark::write(std::string const& path)
+{
+    auto const first_unread = _frame > frames_in_flight ? _frame - frames_in_flight : 0u;
+    for (auto frame = first_unread; frame < _frame; ++frame)
+        read_gpu_time(frame);
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LogError("Failed to open \"%s\" for writing the benchmark results", path.c_str());
+        return false;
+    }
+    file << std::fixed << std::setprecision(4);
+
+    static char const* const counter_names[] = {
+        "primitives_generated", "gs_invocations", "gs_primitives",
+        "clipping_input", "clipping_output", "fragment_invocations"
+    };
+
+    auto const as_json = ends_with(path, ".json");
+    if (as_json) {
+        file << "{\n  \"frames\": [\n";
+    } else {
+        file << "frame,cpu_ms,gpu_ms";
+        for (auto const name : counter_names)
+            file << "," << name;
+        file << "\n";
+    }
+    for (size_t i = 0u; i < _times.size(); ++i) {
+        auto const& times = _times[i];
+        // Frames whose counters never arrived are written as missing.
+        auto const counters = i < _counters.size() ? _counters[i] : pipeline_counters();
+        GLint64 const counter_values[] = {
+            counters.primitives_generated, counters.gs_invocations, counters.gs_primitives,
+            counters.clipping_input, counters.clipping_output, counters.fragment_invocations
+        };
+        if (as_json) {
+            file << "    { \"frame\": " << i << ", \"cpu_ms\": " << times.cpu << ", \"gpu_ms\": " << times.gpu;
+            for (size_t j = 0u; j < sizeof(counter_values) / sizeof(counter_values[0]); ++j) {
+                file << ", \"" << counter_names[j] << "\": ";
+                write_counter(file, counter_values[j], "null");
+            }
+            file << " }" << (i + 1u < _times.size() ? ",\n" : "\n");
+        } else {
+            file << i << "," << times.cpu << "," << times.gpu;
+            for (auto const value : counter_values) {
+                file << ",";
+                write_counter(file, value, "");
+            }
+            file << "\n";
+        }
+    }
+    if (as_json)
+        file << "  ]\n}\n";
+
+    if (!file.good()) {
+        LogError("Failed to write the benchmark results to \"%s\"", path.c_str());
+        return false;
+    }
+
+    auto cpu_total = 0.0, gpu_total = 0.0, cpu_max = 0.0, gpu_max = 0.0;
+    for (auto const& times : _times) {
+        cpu_total += times.cpu;
+        gpu_total += times.gpu;
+        cpu_max = std::max(cpu_max, times.cpu);
+        gpu_max = std::max(gpu_max, times.gpu);
+    }
+    auto const frames_nb = static_cast<double>(std::max<size_t>(_times.size(), 1u));
+    LogInfo("Benchmarked %u frames: CPU %.3f ms on average (%.3f ms max), GPU %.3f ms on average (%.3f ms max); results written to \"%s\"",
+            static_cast<unsigned int>(_times.size()), cpu_total / frames_nb, cpu_max, gpu_total / frames_nb, gpu_max, path.c_str());
+    return true;
+}
+
+void
+edan35::Benchmark::read_gpu_time(size_t frame)
+{
+    auto const slot = frame % frames_in_flight;
+    GLuint64 start = 0u, end = 0u;
+    glGetQueryObjectui64v(_queries[2u * slot], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(_queries[2u * slot + 1u], GL_QUERY_RESULT, &end);
+    _times[frame].gpu = static_cast<double>(end - start) * 0.000001;
+}
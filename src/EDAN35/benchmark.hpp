@@ -0,0 +1,100 @@
+#pragma once
+
+#include "density_tiles.hpp"
+#include "noise.hpp"
+#include "pipeline_statistics.hpp"
+
+#include "core/FPSCamera.h"
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief How Terrainer should run a benchmark, as given on the
+    //!        command line.
+    struct benchmark_settings {
+        bool        enabled;     //!< whether to benchmark rather than run interactively
+        size_t      frames_nb;   //!< number of frames to record
+        std::string output_path; //!< where to write the results; JSON if ending in ".json", CSV otherwise
+        noise_kind  noise;       //!< noise the terrain starts with, to compare both in benchmarks
+        tile_format tiles;       //!< format of the baked tiles, or `none` to evaluate every chunk
+
+        benchmark_settings() : enabled(false), frames_nb(1000u), output_path("terrainer_bench.csv"), noise(noise_kind::gradient),
+                               tiles(tile_format::r16f)
+        {
+        }
+    };
+
+    //! \brief Flies the camera along a fixed path and records how long
+    //!        every frame took, on the CPU and on the GPU.
+    //!
+    //! The path only depends on the frame index, so that runs on different
+    //! machines, or before and after a change, render the same frames. GPU
+    //! times are measured with `GL_TIMESTAMP` queries, which unlike
+    //! `GL_TIME_ELAPSED` ones can overlap the zones of the profiler, and are
+    //! read a few frames late so that recording them does not stall the
+    //! pipeline.
+    class Benchmark {
+    public:
+        //! \brief Create a benchmark.
+        //!
+        //! @param [in] frames_nb number of frames to record
+        Benchmark(size_t frames_nb);
+
+        //! \brief Release the timer queries.
+        ~Benchmark();
+
+        Benchmark(Benchmark const&) = delete;
+        Benchmark& operator=(Benchmark const&) = delete;
+
+        //! \brief Place the camera where it should be for the current frame.
+        void move_camera(FPSCameraf& camera) const;
+
+        //! \brief Start timing the GPU work of the current frame.
+        void begin_frame();
+
+        //! \brief Stop timing the GPU work of the current frame, and move on
+        //!        to the next one.
+        //!
+        //! @param [in] cpu_time time in milliseconds the CPU spent on the
+        //!             frame, excluding waiting for the buffer swap
+        void end_frame(double cpu_time);
+
+        //! \brief Record the pipeline statistics of a frame, which may
+        //!        arrive a few frames after the frame itself, or before it
+        //!        ended.
+        void set_counters(pipeline_counters const& counters);
+
+        //! \brief Return whether all frames have been recorded.
+        bool is_done() const;
+
+        //! \brief Write the recorded times, waiting for the last GPU
+        //!        results if needed.
+        //!
+        //! @param [in] path file to write; JSON if ending in ".json", CSV
+        //!             otherwise
+        //! @return whether the file could be written
+        bool write(std::string const& path);
+
+    private:
+        struct frame_times {
+            double cpu; // in milliseconds
+            double gpu; // in milliseconds, negative until the query result is read
+        };
+
+        void read_gpu_time(size_t frame);
+
+        size_t _frames_nb;
+        size_t _frame;
+        std::vector<frame_times> _times;
+        std::vector<pipeline_counters> _counters; // by frame; may get ahead of _times
+        static constexpr size_t frames_in_flight = 4u;
+        std::array<GLuint, 2u * frames_in_flight> _queries; // start and end of every frame in flight
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+
+namespace edan35
+{
+    //! \brief Level of detail of a chunk, and of the chunks sharing its
+    //!        faces and edges.
+    //!
+    //! At level `l`, cells are `2^l` times larger than at level 0. Faces
+    //! shared with a coarser chunk have their density samples resampled
+    //! from the coarser lattice so that both sides of the face agree, and
+    //! so do edges shared with a coarser chunk, even if only diagonally.
+    //!
+    //! Edge `4 * a + 2 * s_v + s_u` runs along axis `a`, on the `s_u` side
+    //! (0 for -, 1 for +) along axis `(a + 1) % 3` and the `s_v` side
+    //! along axis `(a + 2) % 3`.
+    struct chunk_lod {
+        int level;                      //!< level of the chunk itself
+        std::array<int, 6> neighbours;  //!< levels across the -x, +x, -y, +y, -z and +z faces
+        std::array<int, 12> diagonals;  //!< levels of the chunks sharing only an edge
+
+        chunk_lod() : level(0), neighbours(), diagonals()
+        {
+            neighbours.fill(0);
+            diagonals.fill(0);
+        }
+
+        //! \brief Return how many cells of this chunk a cell of the
+        //!        neighbour across a face spans, along each axis of the
+        //!        face; 1 if the neighbour is not coarser.
+        int get_face_ratio(size_t face) const
+        {
+            return neighbours[face] > level ? 1 << (neighbours[face] - level) : 1;
+        }
+
+        //! \brief Return how many cells of this chunk a cell of the
+        //!        coarsest chunk sharing an edge spans; 1 if none is
+        //!        coarser.
+        int get_edge_ratio(size_t edge) const
+        {
+            auto const axis = edge / 4u;
+            auto const ratio = std::max(get_face_ratio(2u * ((axis + 1u) % 3u) + (edge & 1u)),
+                                        get_face_ratio(2u * ((axis + 2u) % 3u) + ((edge >> 1u) & 1u)));
+            return std::max(ratio, diagonals[edge] > level ? 1 << (diagonals[edge] - level) : 1);
+        }
+
+        bool operator==(chunk_lod const& other) const
+        {
+            return level == other.level && neighbours == other.neighbours && diagonals == other.diagonals;
+        }
+
+        bool operator!=(chunk_lod const& other) const
+        {
+            return !(*this == other);
+        }
+    };
+}
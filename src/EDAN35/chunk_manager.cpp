@@ -0,0 +1,197 @@
+#include "chunk_manager.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+
+static int
+squared_length(glm::ivec3 const& v)
+{
+    return v.x * v.x + v.y * v.y + v.z * v.z;
+}
+
+edan35::ChunkManager::ChunkManager(float chunk_size, int view_radius, size_t pool_size, size_t generations_per_update)
+    : _chunk_size(chunk_size), _view_radius(view_radius), _generations_per_update(generations_per_update),
+      _frame(0u), _generated_last_update(0u), _culled_last_update(0u), _pool(pool_size), _view_offsets(), _lod_radii(), _resident(),
+      _generate(), _evict(), _is_visible()
+{
+    assert(chunk_size > 0.0f && view_radius >= 0 && pool_size > 0u);
+
+    for (int z = -view_radius; z <= view_radius; ++z)
+    for (int y = -view_radius; y <= view_radius; ++y)
+    for (int x = -view_radius; x <= view_radius; ++x) {
+        auto const offset = glm::ivec3(x, y, z);
+        if (squared_length(offset) <= view_radius * view_radius)
+            _view_offsets.push_back(offset);
+    }
+    std::stable_sort(_view_offsets.begin(), _view_offsets.end(),
+                     [](glm::ivec3 const& a, glm::ivec3 const& b) {
+                         return squared_length(a) < squared_length(b);
+                     });
+
+    if (_view_offsets.size() > pool_size)
+        LogWarning("The chunk pool (%u slots) is smaller than the view range (%u chunks): distant chunks will not be loaded.",
+                   static_cast<unsigned int>(pool_size), static_cast<unsigned int>(_view_offsets.size()));
+
+    _resident.reserve(pool_size);
+}
+
+void
+edan35::ChunkManager::set_generate_callback(generate_callback const& callback)
+{
+    _generate = callback;
+}
+
+void
+edan35::ChunkManager::set_evict_callback(evict_callback const& callback)
+{
+    _evict = callback;
+}
+
+void
+edan35::ChunkManager::set_visibility_callback(visibility_callback const& callback)
+{
+    _is_visible = callback;
+}
+
+void
+edan35::ChunkManager::set_lod_radii(std::vector<float> const& radii)
+{
+    assert(std::is_sorted(radii.begin(), radii.end()));
+    _lod_radii = radii;
+}
+
+void
+edan35::ChunkManager::update(glm::vec3 const& position)
+{
+    ++_frame;
+    _generated_last_update = 0u;
+    _culled_last_update = 0u;
+
+    auto const generate = [this](chunk& c, chunk_lod const& lod) {
+        c.lod = lod;
+        if (_generate)
+            _generate(c);
+        c.generated = true;
+        ++_generated_last_update;
+    };
+
+    auto const camera_coord = get_chunk_coord(position);
+    for (auto const& offset : _view_offsets) {
+        auto const coord = camera_coord + offset;
+        auto const lod = get_lod(offset);
+
+        // Out-of-view chunks are skipped before any work is done for them.
+        auto const origin = get_chunk_origin(coord);
+        auto const is_visible = !_is_visible || _is_visible(origin, origin + glm::vec3(_chunk_size));
+        if (!is_visible)
+            ++_culled_last_update;
+        auto const can_generate = is_visible && _generated_last_update < _generations_per_update;
+
+        auto const it = _resident.find(coord);
+        if (it != _resident.end()) {
+            auto& c = _pool[it->second];
+            c.last_used = _frame;
+            if ((!c.generated || c.lod != lod) && can_generate)
+                generate(c, lod);
+            continue;
+        }
+
+        if (!can_generate)
+            continue;
+
+        auto* const c = acquire_slot(camera_coord);
+        if (c == nullptr)
+            break;
+        c->coord = coord;
+        c->resident = true;
+        c->generated = false;
+        c->last_used = _frame;
+        _resident.emplace(coord, static_cast<size_t>(c - _pool.data()));
+        generate(*c, lod);
+    }
+}
+
+void
+edan35::ChunkManager::invalidate()
+{
+    for (auto& c : _pool)
+        c.generated = false;
+}
+
+glm::ivec3
+edan35::ChunkManager::get_chunk_coord(glm::vec3 const& position) const
+{
+    return glm::ivec3(static_cast<int>(std::floor(position.x / _chunk_size)),
+                      static_cast<int>(std::floor(position.y / _chunk_size)),
+                      static_cast<int>(std::floor(position.z / _chunk_size)));
+}
+
+glm::vec3
+edan35::ChunkManager::get_chunk_origin(glm::ivec3 const& coord) const
+{
+    return glm::vec3(static_cast<float>(coord.x) * _chunk_size,
+                     static_cast<float>(coord.y) * _chunk_size,
+                     static_cast<float>(coord.z) * _chunk_size);
+}
+
+edan35::chunk*
+edan35::ChunkManager::acquire_slot(glm::ivec3 const& camera_coord)
+{
+    chunk* candidate = nullptr;
+    int candidate_distance = -1;
+    for (auto& c : _pool) {
+        if (!c.resident)
+            return &c;
+        // Chunks still in view range this frame are never evicted.
+        if (c.last_used == _frame)
+            continue;
+        auto const distance = squared_length(c.coord - camera_coord);
+        if (distance > candidate_distance) {
+            candidate = &c;
+            candidate_distance = distance;
+        }
+    }
+    if (candidate == nullptr)
+        return nullptr;
+
+    if (_evict)
+        _evict(*candidate);
+    _resident.erase(candidate->coord);
+    candidate->resident = false;
+    candidate->generated = false;
+    return candidate;
+}
+
+int
+edan35::ChunkManager::get_level(glm::ivec3 const& offset) const
+{
+    auto const distance = std::sqrt(static_cast<float>(squared_length(offset)));
+    return static_cast<int>(std::upper_bound(_lod_radii.begin(), _lod_radii.end(), distance) - _lod_radii.begin());
+}
+
+edan35::chunk_lod
+edan35::ChunkManager::get_lod(glm::ivec3 const& offset) const
+{
+    static glm::ivec3 const face_directions[6] = {
+        glm::ivec3(-1, 0, 0), glm::ivec3(1, 0, 0),
+        glm::ivec3(0, -1, 0), glm::ivec3(0, 1, 0),
+        glm::ivec3(0, 0, -1), glm::ivec3(0, 0, 1)
+    };
+
+    chunk_lod lod;
+    lod.level = get_level(offset);
+    for (size_t i = 0u; i < 6u; ++i)
+        lod.neighbours[i] = get_level(offset + face_directions[i]);
+    for (size_t i = 0u; i < 12u; ++i) {
+        auto const axis = static_cast<int>(i / 4u);
+        auto direction = glm::ivec3(0);
+        direction[(axis + 1) % 3] = (i & 1u) != 0u ? 1 : -1;
+        direction[(axis + 2) % 3] = (i & 2u) != 0u ? 1 : -1;
+        lod.diagonals[i] = get_level(offset + direction);
+    }
+    return lod;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "chunk_lod.hpp"
+#include "helpers.hpp"
+#include "mesh_pool.hpp"
+#include "node.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Hash functor allowing chunk coordinates to be used as keys
+    //!        of unordered containers.
+    struct chunk_coord_hash {
+        size_t operator()(glm::ivec3 const& coord) const
+        {
+            // Large primes, as in "Optimized Spatial Hashing for Collision
+            // Detection of Deformable Objects" (Teschner et al.)
+            // Unsigned, as signed products would overflow.
+            return static_cast<size_t>((static_cast<std::uint32_t>(coord.x) * 73856093u)
+                                     ^ (static_cast<std::uint32_t>(coord.y) * 19349663u)
+                                     ^ (static_cast<std::uint32_t>(coord.z) * 83492791u));
+        }
+    };
+
+    //! \brief A fixed-size cube of world space, generated and drawn as a
+    //!        whole.
+    struct chunk {
+        glm::ivec3 coord;     //!< position of the chunk in the chunk grid
+        bool       resident;  //!< whether this pool slot currently holds a chunk
+        bool       generated; //!< whether the terrain of the chunk is up-to-date
+        size_t     last_used; //!< last frame during which the chunk was in view range
+        chunk_lod  lod;       //!< level of detail the chunk was generated at
+        Node       node;      //!< node used to draw the chunk
+
+        eda221::mesh_data active_cells;          //!< one point per cell crossed by the surface
+        size_t            active_cells_capacity; //!< size in bytes of the active cells buffer
+        eda221::mesh_data mesh;                  //!< extracted triangles, if cached
+        size_t            mesh_capacity;         //!< size in bytes of the mesh buffer
+        GLuint            extraction_queries[2]; //!< triangles generated and written by the latest extraction, see GPUMesher
+        bool              extraction_pending;    //!< whether their results are yet to be read
+        pool_mesh         pooled_mesh;           //!< triangles meshed on the CPU, see MeshPool
+        size_t            mesh_ticket;           //!< identifies the latest mesh requested for the chunk
+        GLuint            density_tex;           //!< density at every cell corner, see DensityPass
+        unsigned int      density_corners_nb;    //!< size of the density texture along each axis
+        GLuint            occlusion_query;       //!< samples of the chunk that passed the depth test, see OcclusionCuller
+        bool              occlusion_pending;     //!< whether the query result is yet to be read
+        bool              occluded;              //!< whether the latest query found the chunk fully hidden
+
+        chunk() : coord(0), resident(false), generated(false), last_used(0u), lod(), node(), active_cells(), active_cells_capacity(0u), mesh(), mesh_capacity(0u), extraction_queries(), extraction_pending(false), pooled_mesh(), mesh_ticket(0u), density_tex(0u), density_corners_nb(0u), occlusion_query(0u), occlusion_pending(false), occluded(false)
+        {
+        }
+    };
+
+    //! \brief Tiles world space into fixed-size chunks and keeps the ones
+    //!        surrounding a point of interest in a bounded pool.
+    //!
+    //! Chunks are loaded nearest first, with at most a fixed amount of
+    //! them generated per update, so that moving fast does not cause
+    //! frame spikes. Chunks get coarser with their distance to the
+    //! point of interest, and are regenerated when their level of
+    //! detail, or that of a chunk sharing one of their faces or edges,
+    //! changes; until then, the previous mesh stays in use. When the
+    //! pool is full, the resident chunk furthest away from the point of
+    //! interest and outside of the view range is evicted to make room
+    //! for the new one.
+    class ChunkManager {
+    public:
+        //! \brief Called whenever a chunk needs its content (re)generated.
+        using generate_callback = std::function<void (chunk&)>;
+
+        //! \brief Called whenever a chunk is about to be evicted.
+        using evict_callback = std::function<void (chunk&)>;
+
+        //! \brief Return whether a world-space box is in view.
+        using visibility_callback = std::function<bool (glm::vec3 const& min_corner, glm::vec3 const& max_corner)>;
+
+        //! \brief Create a chunk manager.
+        //!
+        //! @param [in] chunk_size length in world units of a chunk edge
+        //! @param [in] view_radius radius, in chunks, of the sphere of
+        //!             chunks to keep around the point of interest
+        //! @param [in] pool_size maximum number of resident chunks
+        //! @param [in] generations_per_update maximum number of chunks
+        //!             generated during a single call to `update()`
+        ChunkManager(float chunk_size, int view_radius, size_t pool_size,
+                     size_t generations_per_update);
+
+        //! \brief Set the function used to generate chunks.
+        void set_generate_callback(generate_callback const& callback);
+
+        //! \brief Set the function called before a chunk is evicted.
+        void set_evict_callback(evict_callback const& callback);
+
+        //! \brief Set the function deciding whether chunks are in view.
+        //!
+        //! Chunks out of view are neither loaded nor generated, but the
+        //! resident ones are kept as long as they are in view range, so
+        //! that turning around does not require loading them again.
+        void set_visibility_callback(visibility_callback const& callback);
+
+        //! \brief Set the distances at which chunks switch to a coarser
+        //!        level of detail.
+        //!
+        //! @param [in] radii increasing distances, in chunks: chunks
+        //!             further than `radii[i]` from the point of interest
+        //!             are at least at level `i + 1`
+        void set_lod_radii(std::vector<float> const& radii);
+
+        //! \brief Load and generate the chunks surrounding a position, and
+        //!        evict distant ones if the pool is exhausted.
+        //!
+        //! @param [in] position world-space position, usually the
+        //!             camera's, around which chunks should be resident
+        void update(glm::vec3 const& position);
+
+        //! \brief Mark all resident chunks as needing to be regenerated.
+        void invalidate();
+
+        //! \brief Return the coordinates of the chunk containing a
+        //!        world-space position.
+        glm::ivec3 get_chunk_coord(glm::vec3 const& position) const;
+
+        //! \brief Return the world-space position of the minimum corner of
+        //!        a chunk.
+        glm::vec3 get_chunk_origin(glm::ivec3 const& coord) const;
+
+        //! \brief Return the length in world units of a chunk edge.
+        float get_chunk_size() const { return _chunk_size; }
+
+        //! \brief Return the view radius, in chunks.
+        int get_view_radius() const { return _view_radius; }
+
+        //! \brief Return the whole chunk pool, including non-resident
+        //!        slots.
+        std::vector<chunk>& get_chunks() { return _pool; }
+
+        //! \brief Return the number of resident chunks.
+        size_t get_resident_nb() const { return _resident.size(); }
+
+        //! \brief Return the number of chunks that were generated during
+        //!        the last update.
+        size_t get_generated_nb() const { return _generated_last_update; }
+
+        //! \brief Return the number of chunks in view range that were
+        //!        skipped during the last update for being out of view.
+        size_t get_culled_nb() const { return _culled_last_update; }
+
+    private:
+        chunk* acquire_slot(glm::ivec3 const& camera_coord);
+        int get_level(glm::ivec3 const& offset) const;
+        chunk_lod get_lod(glm::ivec3 const& offset) const;
+
+        float _chunk_size;
+        int _view_radius;
+        size_t _generations_per_update;
+        size_t _frame;
+        size_t _generated_last_update;
+        size_t _culled_last_update;
+
+        std::vector<chunk> _pool;
+        std::vector<glm::ivec3> _view_offsets; // sorted nearest first
+        std::vector<float> _lod_radii;
+        std::unordered_map<glm::ivec3, size_t, chunk_coord_hash> _resident;
+
+        generate_callback _generate;
+        evict_callback _evict;
+        visibility_callback _is_visible;
+    };
+}
@@ -0,0 +1,430 @@
+#include "cpu_mesher.hpp"
+
+#include "core/Log.h"
+#include "core/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+
+namespace
+{
+    // Corner layout of a cell, matching `marching.geo`.
+    glm::vec3 const corner_offsets[8] = {
+        glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 1.0f),
+        glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f)
+    };
+
+    // Corners joined by each edge, lowest coordinate first.
+    int const edge_corners[12][2] = {
+        { 0, 1 }, { 1, 2 }, { 3, 2 }, { 0, 3 },
+        { 4, 5 }, { 5, 6 }, { 7, 6 }, { 4, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+    };
+
+    // Axis along which each edge runs.
+    int const edge_axes[12] = { 1, 0, 1, 0, 1, 0, 1, 0, 2, 2, 2, 2 };
+
+    unsigned int const no_vertex = ~0u;
+}
+
+edan35::CPUMesher::CPUMesher(int const* edge_connections, std::uint32_t seed,
+                             unsigned int cells_nb, size_t threads_nb)
+    : _edge_connections(edge_connections), _seed(seed), _noise(noise_kind::gradient),
+      _program_mutex(), _program(std::make_shared<density_program>()), _tiles(nullptr), _cells_nb(cells_nb),
+      _finished_mutex(), _finished(), _pending_nb(0u), _workers(threads_nb)
+{
+    assert(edge_connections != nullptr && cells_nb > 0u);
+    LogInfo("Evaluating the density with %s", get_noise_isa());
+}
+
+edan35::CPUMesher::~CPUMesher()
+{
+    _workers.Wait();
+}
+
+void
+edan35::CPUMesher::set_program(std::shared_ptr<density_program const> program)
+{
+    assert(program != nullptr);
+    std::lock_guard<std::mutex> lock(_program_mutex);
+    _program = std::move(program);
+}
+
+void
+edan35::CPUMesher::request(glm::ivec3 const& coord, size_t ticket, glm::vec3 const& center, float half_size,
+                           chunk_lod const& lod)
+{
+    ++_pending_nb;
+    _workers.Enqueue([this, coord, ticket, center, half_size, lod]() {
+        PROFILE_ZONE("Mesh chunk");
+        auto m = mesh(coord, ticket, center, half_size, lod);
+        std::lock_guard<std::mutex> lock(_finished_mutex);
+        _finished.emplace_back(std::move(m));
+    });
+}
+
+std::vector<edan35::cpu_mesh>
+edan35::CPUMesher::collect()
+{
+    std::vector<cpu_mesh> finished;
+    {
+        std::lock_guard<std::mutex> lock(_finished_mutex);
+        finished.swap(_finished);
+    }
+    _pending_nb -= finished.size();
+    return finished;
+}
+
+edan35::cpu_mesh
+edan35::CPUMesher::mesh(glm::ivec3 const& coord, size_t ticket, glm::vec3 const& center, float half_size,
+                        chunk_lod const& lod) const
+{
+    cpu_mesh result;
+    result.coord = coord;
+    result.ticket = ticket;
+
+    // Same grid as `parametric_shapes::create_cube()`: one cell per point,
+    // starting at -1 in model space.
+    auto const cells_nb = std::max(_cells_nb >> lod.level, 1u);
+    auto const step = 2.0f / static_cast<float>(cells_nb);
+    // One more corner than cells to close the last cell, and one apron
+    // corner on each side for the central differences.
+    auto const corners_nb = cells_nb + 3u;
+    auto const noise = _noise.load();
+    std::shared_ptr<density_program const> program;
+    {
+        std::lock_guard<std::mutex> lock(_program_mutex);
+        program = _program;
+    }
+
+    // Evaluate the density once per corner, as neighbouring cells share
+    // most of theirs. Corners are addressed relative to the chunk, so the
+    // apron lies at -1 and `cells_nb + 1`.
+    std::vector<float> lattice(corners_nb * corners_nb * corners_nb);
+    auto const lattice_index = [corners_nb](unsigned int i, unsigned int j, unsigned int k) {
+        return ((k + 1u) * corners_nb + (j + 1u)) * corners_nb + (i + 1u);
+    };
+    auto const tiles = _tiles.load();
+    auto const tile = tiles != nullptr ? tiles->find(coord) : nullptr;
+    if (tile != nullptr && static_cast<size_t>(lod.level) < tile->levels.size()) {
+        // Baked with the same layout.
+        decode_density_tile(*tile, lod.level, lattice.data());
+    } else {
+        // Corners are evaluated a slice at a time by the batched density.
+        std::vector<float> coords(corners_nb);
+        auto const plane_size = corners_nb * corners_nb;
+        std::vector<float> xs(plane_size), ys(plane_size), zs(plane_size);
+        auto const axis_coords = [&coords, corners_nb, step, half_size](float center) {
+            for (unsigned int i = 0u; i < corners_nb; ++i)
+                coords[i] = center + half_size * ((-1.0f - step) + step * static_cast<float>(i));
+        };
+        axis_coords(center.x);
+        for (unsigned int j = 0u; j < corners_nb; ++j)
+            std::copy(coords.begin(), coords.end(), xs.begin() + j * corners_nb);
+        axis_coords(center.y);
+        for (unsigned int j = 0u; j < corners_nb; ++j)
+            std::fill_n(ys.begin() + j * corners_nb, corners_nb, coords[j]);
+        axis_coords(center.z);
+        for (unsigned int k = 0u; k < corners_nb; ++k) {
+            std::fill(zs.begin(), zs.end(), coords[k]);
+            density(*program, _seed, noise, xs.data(), ys.data(), zs.data(), lattice.data() + k * plane_size, plane_size);
+        }
+    }
+
+    // On faces shared with a coarser chunk, replace the samples by the
+    // bilinear interpolation of the coarse ones: zero crossings along the
+    // coarse edges then land exactly where the coarse chunk puts them.
+    // Coarse corners coincide with fine ones, and are left untouched.
+    // Chunk edges come first, interpolated linearly over the coarsest of
+    // the chunks sharing them, diagonal ones included, as in
+    // `density.frag`: the faces then interpolate between those samples,
+    // so that all four chunks agree along the edge.
+    for (size_t edge = 0u; edge < 12u; ++edge) {
+        auto const ratio = static_cast<unsigned int>(lod.get_edge_ratio(edge));
+        if (ratio == 1u || cells_nb % ratio != 0u)
+            continue;
+        auto const axis = static_cast<int>(edge / 4u);
+        auto const edge_index = [&lattice_index, axis, edge, cells_nb](unsigned int w) {
+            glm::uvec3 corner;
+            corner[axis] = w;
+            corner[(axis + 1) % 3] = (edge & 1u) != 0u ? cells_nb : 0u;
+            corner[(axis + 2) % 3] = (edge & 2u) != 0u ? cells_nb : 0u;
+            return lattice_index(corner.x, corner.y, corner.z);
+        };
+        for (unsigned int w = 0u; w <= cells_nb; ++w) {
+            auto const w_0 = w - w % ratio;
+            if (w_0 == w)
+                continue;
+            auto const f = static_cast<float>(w - w_0) / static_cast<float>(ratio);
+            lattice[edge_index(w)] = glm::mix(lattice[edge_index(w_0)], lattice[edge_index(w_0 + ratio)], f);
+        }
+    }
+    for (size_t face = 0u; face < 6u; ++face) {
+        auto const ratio = static_cast<unsigned int>(lod.get_face_ratio(face));
+        if (ratio == 1u || cells_nb % ratio != 0u)
+            continue;
+        auto const axis = face / 2u;
+        auto const side = face % 2u == 0u ? 0u : cells_nb;
+        auto const face_index = [&lattice_index, axis, side](unsigned int u, unsigned int v) {
+            glm::uvec3 corner;
+            corner[static_cast<int>(axis)] = side;
+            corner[static_cast<int>((axis + 1u) % 3u)] = u;
+            corner[static_cast<int>((axis + 2u) % 3u)] = v;
+            return lattice_index(corner.x, corner.y, corner.z);
+        };
+        for (unsigned int u = 1u; u < cells_nb; ++u)
+        for (unsigned int v = 1u; v < cells_nb; ++v) {
+            auto const u_0 = u - u % ratio, v_0 = v - v % ratio;
+            if (u_0 == u && v_0 == v)
+                continue;
+            auto const u_1 = u_0 + ratio, v_1 = v_0 + ratio;
+            auto const f_u = static_cast<float>(u - u_0) / static_cast<float>(ratio);
+            auto const f_v = static_cast<float>(v - v_0) / static_cast<float>(ratio);
+            lattice[face_index(u, v)] = glm::mix(glm::mix(lattice[face_index(u_0, v_0)], lattice[face_index(u_1, v_0)], f_u),
+                                                 glm::mix(lattice[face_index(u_0, v_1)], lattice[face_index(u_1, v_1)], f_u),
+                                                 f_v);
+        }
+    }
+
+    // The density grows towards the inside of the ground, so the surface
+    // normal is minus its gradient.
+    auto const lattice_normal = [&lattice, &lattice_index](glm::uvec3 const& corner) {
+        auto const at = [&lattice, &lattice_index, &corner](int x, int y, int z) {
+            // Unsigned wrap-around cancels out in lattice_index().
+            return lattice[lattice_index(corner.x + static_cast<unsigned int>(x),
+                                         corner.y + static_cast<unsigned int>(y),
+                                         corner.z + static_cast<unsigned int>(z))];
+        };
+        return -glm::vec3(at(1, 0, 0) - at(-1, 0, 0),
+                          at(0, 1, 0) - at(0, -1, 0),
+                          at(0, 0, 1) - at(0, 0, -1));
+    };
+
+    auto const cell_densities = [&lattice, &lattice_index](unsigned int i, unsigned int j, unsigned int k, float densities[8]) {
+        for (int c = 0; c < 8; ++c) {
+            auto const& offset = corner_offsets[c];
+            densities[c] = lattice[lattice_index(i + static_cast<unsigned int>(offset.x),
+                                                 j + static_cast<unsigned int>(offset.y),
+                                                 k + static_cast<unsigned int>(offset.z))];
+        }
+    };
+
+    // Classify every cell and only keep the ones crossed by the surface,
+    // which usually are a small fraction of the chunk.
+    struct active_cell {
+        unsigned int i, j, k;
+        int lookup_idx;
+    };
+    std::vector<active_cell> active_cells;
+    size_t triangles_nb = 0u;
+    float densities[8];
+    for (unsigned int i = 0u; i < cells_nb; ++i)
+    for (unsigned int j = 0u; j < cells_nb; ++j)
+    for (unsigned int k = 0u; k < cells_nb; ++k) {
+        cell_densities(i, j, k, densities);
+        int lookup_idx = 0;
+        for (int c = 0; c < 8; ++c)
+            if (densities[c] > 0.0f)
+                lookup_idx |= 1 << c;
+        if (lookup_idx == 0 || lookup_idx == 255)
+            continue;
+
+        active_cells.push_back({ i, j, k, lookup_idx });
+        auto const* const triangles = _edge_connections + 20 * lookup_idx;
+        for (int t = 0; t < 5 && triangles[4 * t] != -1; ++t)
+            ++triangles_nb;
+    }
+
+    // Polygonise the compacted list. Vertices are created once per grid
+    // edge crossed by the surface and shared by all the triangles using
+    // them, whichever cell they belong to.
+    std::vector<unsigned int> edge_vertices(3u * lattice.size(), no_vertex);
+    result.vertices.reserve(triangles_nb);
+    result.normals.reserve(triangles_nb);
+    result.indices.reserve(3u * triangles_nb);
+    auto const get_vertex = [&](glm::uvec3 const& start_corner, int axis) {
+        auto const key = 3u * lattice_index(start_corner.x, start_corner.y, start_corner.z)
+                       + static_cast<unsigned int>(axis);
+        auto& vertex = edge_vertices[key];
+        if (vertex == no_vertex) {
+            auto end_corner = start_corner;
+            ++end_corner[axis];
+            auto const a = lattice[lattice_index(start_corner.x, start_corner.y, start_corner.z)];
+            auto const b = lattice[lattice_index(end_corner.x, end_corner.y, end_corner.z)];
+            // Where the density crosses zero along the edge, in [0, 1].
+            auto const t = a / (a - b);
+            auto position = glm::vec3(start_corner);
+            position[axis] += t;
+            vertex = static_cast<unsigned int>(result.vertices.size());
+            result.vertices.push_back(glm::vec3(-1.0f) + step * position);
+            auto const normal = glm::mix(lattice_normal(start_corner), lattice_normal(end_corner), t);
+            auto const length = glm::length(normal);
+            result.normals.push_back(length > 0.0f ? normal / length : normal);
+        }
+        return vertex;
+    };
+    for (auto const& cell : active_cells) {
+        auto const cell_corner = glm::uvec3(cell.i, cell.j, cell.k);
+        auto const get_edge_vertex = [&](int edge) {
+            auto const start = glm::uvec3(corner_offsets[edge_corners[edge][0]]);
+            return get_vertex(cell_corner + start, edge_axes[edge]);
+        };
+
+        auto const* const triangles = _edge_connections + 20 * cell.lookup_idx;
+        for (int t = 0; t < 5 && triangles[4 * t] != -1; ++t) {
+            result.indices.push_back(get_edge_vertex(triangles[4 * t + 0]));
+            result.indices.push_back(get_edge_vertex(triangles[4 * t + 1]));
+            result.indices.push_back(get_edge_vertex(triangles[4 * t + 2]));
+        }
+    }
+
+    // On faces shared with a coarser chunk, the coarse chunk crosses each
+    // of its face squares with one segment, or with two when crossed four
+    // times, which then cut off the corners where the density is
+    // positive: that is how the lookup table pairs the crossings of a
+    // face, whatever the rest of the cell. Ours follow the resampled
+    // densities in smaller steps. Close the slivers in between, in the
+    // plane of the face: every edge our triangles leave open on the face
+    // gets a triangle from the first coarse crossing of its square, and
+    // squares crossed four times get one more, from that crossing to the
+    // coarse segment not ending there. `marching.geo` does the same.
+    auto const polygonised_nb = result.indices.size();
+    for (size_t face = 0u; face < 6u; ++face) {
+        auto const ratio = static_cast<unsigned int>(lod.get_face_ratio(face));
+        if (ratio == 1u || cells_nb % ratio != 0u)
+            continue;
+        auto const axis = static_cast<int>(face / 2u);
+        auto const u_axis = (axis + 1) % 3;
+        auto const v_axis = (axis + 2) % 3;
+        auto const side = face % 2u == 0u ? 0u : cells_nb;
+        auto const face_position = -1.0f + step * static_cast<float>(side);
+        auto const face_corner = [axis, u_axis, v_axis, side](unsigned int u, unsigned int v) {
+            glm::uvec3 corner;
+            corner[axis] = side;
+            corner[u_axis] = u;
+            corner[v_axis] = v;
+            return corner;
+        };
+        auto const face_density = [&lattice, &lattice_index, &face_corner](unsigned int u, unsigned int v) {
+            auto const corner = face_corner(u, v);
+            return lattice[lattice_index(corner.x, corner.y, corner.z)];
+        };
+
+        // Where the edges of the coarse square starting at (u_0, v_0) are
+        // crossed, along u at v_0 and v_0 + ratio, then along v at u_0
+        // and u_0 + ratio: the resampled densities are linear along them,
+        // so at most once.
+        struct coarse_square {
+            size_t crossings_nb;
+            unsigned int vertices[4];
+            unsigned int steps[4];  // fine edges before each crossing along its coarse edge
+        };
+        auto const get_coarse_square = [&](unsigned int u_0, unsigned int v_0) {
+            coarse_square square;
+            square.crossings_nb = 0u;
+            auto const add_crossing = [&](unsigned int u, unsigned int v, int along) {
+                auto const du = along == u_axis ? 1u : 0u;
+                auto const dv = along == v_axis ? 1u : 0u;
+                for (unsigned int n = 0u; n < ratio; ++n, u += du, v += dv) {
+                    if ((face_density(u, v) > 0.0f) != (face_density(u + du, v + dv) > 0.0f)) {
+                        square.vertices[square.crossings_nb] = get_vertex(face_corner(u, v), along);
+                        square.steps[square.crossings_nb++] = n;
+                        return;
+                    }
+                }
+            };
+            add_crossing(u_0, v_0, u_axis);
+            add_crossing(u_0, v_0 + ratio, u_axis);
+            add_crossing(u_0, v_0, v_axis);
+            add_crossing(u_0 + ratio, v_0, v_axis);
+            return square;
+        };
+
+        // Of a square crossed four times, the coarse segment not ending at
+        // the first crossing, as the lookup table runs through it: it cuts
+        // off the positive corner at v_0 + ratio, and which way it runs
+        // depends on that corner and on the side of the face. Return
+        // whether the fine edges next to the corner are the ones crossed,
+        // our triangles then already having the same segment.
+        auto const get_other_segment = [&](coarse_square const& square, unsigned int u_0, unsigned int v_0,
+                                           unsigned int segment[2]) {
+            auto const positive_00 = face_density(u_0, v_0) > 0.0f;
+            auto const along_v = positive_00 ? 3u : 2u;
+            auto const from_u = positive_00 == (side == 0u);
+            segment[0] = square.vertices[from_u ? 1u : along_v];
+            segment[1] = square.vertices[from_u ? along_v : 1u];
+            return square.steps[1] == (positive_00 ? ratio - 1u : 0u) && square.steps[along_v] == ratio - 1u;
+        };
+
+        // Edges lying on the face, in the order their triangle runs
+        // through them; those used by a single triangle are open.
+        std::vector<std::pair<unsigned int, unsigned int>> edges;
+        for (size_t i = 0u; i < polygonised_nb; i += 3u)
+        for (size_t e = 0u; e < 3u; ++e) {
+            auto const a = result.indices[i + e];
+            auto const b = result.indices[i + (e + 1u) % 3u];
+            if (result.vertices[a][axis] == face_position && result.vertices[b][axis] == face_position)
+                edges.emplace_back(a, b);
+        }
+        auto const undirected = [](std::pair<unsigned int, unsigned int> const& edge) {
+            return std::minmax(edge.first, edge.second);
+        };
+        std::sort(edges.begin(), edges.end(), [&undirected](std::pair<unsigned int, unsigned int> const& a,
+                                                            std::pair<unsigned int, unsigned int> const& b) {
+            return undirected(a) < undirected(b);
+        });
+
+        for (size_t e = 0u; e < edges.size(); ++e) {
+            if ((e > 0u && undirected(edges[e - 1u]) == undirected(edges[e]))
+             || (e + 1u < edges.size() && undirected(edges[e + 1u]) == undirected(edges[e])))
+                continue;
+            auto const& a = result.vertices[edges[e].first];
+            auto const& b = result.vertices[edges[e].second];
+
+            // The coarse square the edge lies in.
+            auto const square_start = [&a, &b, step, cells_nb, ratio](int along) {
+                auto const cell = static_cast<unsigned int>((0.5f * (a[along] + b[along]) + 1.0f) / step);
+                return std::min(cell, cells_nb - 1u) / ratio * ratio;
+            };
+            auto const u_0 = square_start(u_axis), v_0 = square_start(v_axis);
+            auto const square = get_coarse_square(u_0, v_0);
+            if (square.crossings_nb < 2u)
+                continue;
+            auto const fan_vertex = square.vertices[0];
+            if (fan_vertex == edges[e].first || fan_vertex == edges[e].second)
+                continue;
+            unsigned int segment[2];
+            if (square.crossings_nb == 4u && get_other_segment(square, u_0, v_0, segment)
+             && std::minmax(segment[0], segment[1]) == undirected(edges[e]))
+                continue;
+
+            // Run through the edge the other way round than its triangle,
+            // so that both face the same side.
+            result.indices.push_back(fan_vertex);
+            result.indices.push_back(edges[e].second);
+            result.indices.push_back(edges[e].first);
+        }
+
+        // The fans turn each of our open runs into a pair of edges through
+        // the first crossing, where the coarse chunk has a single segment.
+        // That is right for the run ending at the first crossing, and a
+        // triangle from it to the other coarse segment makes it right for
+        // the other run, whichever crossings our runs join.
+        for (unsigned int u_0 = 0u; u_0 < cells_nb; u_0 += ratio)
+        for (unsigned int v_0 = 0u; v_0 < cells_nb; v_0 += ratio) {
+            auto const square = get_coarse_square(u_0, v_0);
+            unsigned int segment[2];
+            if (square.crossings_nb != 4u || get_other_segment(square, u_0, v_0, segment))
+                continue;
+            result.indices.push_back(square.vertices[0]);
+            result.indices.push_back(segment[0]);
+            result.indices.push_back(segment[1]);
+        }
+    }
+
+    return result;
+}
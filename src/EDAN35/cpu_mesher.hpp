@@ -0,0 +1,123 @@
+#pragma once
+
+#include "chunk_lod.hpp"
+#include "density.hpp"
+#include "density_tiles.hpp"
+
+#include "core/ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Triangles extracted from one chunk, in the model space of
+    //!        the chunk's point grid.
+    struct cpu_mesh {
+        glm::ivec3 coord;                  //!< chunk the mesh was extracted for
+        size_t ticket;                     //!< identifies the request that produced the mesh
+        std::vector<glm::vec3> vertices;   //!< one vertex per grid edge crossed by the surface
+        std::vector<glm::vec3> normals;    //!< one normal per vertex, from the density gradient
+        std::vector<unsigned int> indices; //!< three consecutive indices per triangle
+    };
+
+    //! \brief C++ implementation of the marching-cubes geometry shader,
+    //!        extracting chunks on a pool of worker threads.
+    //!
+    //! The mesher does not touch OpenGL: requests are processed in the
+    //! background and finished meshes are handed back through
+    //! `collect()`, to be uploaded by the thread owning the context.
+    //! `mesh()` runs an extraction synchronously, e.g. for offline
+    //! generation on machines without a GPU.
+    class CPUMesher {
+    public:
+        //! \brief Create a mesher and start its worker threads.
+        //!
+        //! @param [in] edge_connections triangle table, as returned by
+        //!             `Terrainer::create_edge_conn()`; it must outlive
+        //!             the mesher
+        //! @param [in] seed seed of the noise used by the density function
+        //! @param [in] cells_nb number of cells along each chunk edge, at
+        //!             the finest level of detail
+        //! @param [in] threads_nb number of worker threads, 0 to pick one
+        //!             based on the hardware
+        CPUMesher(int const* edge_connections, std::uint32_t seed,
+                  unsigned int cells_nb, size_t threads_nb = 0u);
+
+        //! \brief Wait for the queued extractions, then stop the workers.
+        ~CPUMesher();
+
+        CPUMesher(CPUMesher const&) = delete;
+        CPUMesher& operator=(CPUMesher const&) = delete;
+
+        //! \brief Queue the extraction of a chunk.
+        //!
+        //! @param [in] coord coordinates of the chunk
+        //! @param [in] ticket identifier handed back with the mesh, so
+        //!             that outdated results can be recognised
+        //! @param [in] center world-space center of the chunk
+        //! @param [in] half_size half the length of a chunk edge
+        //! @param [in] lod level of detail of the chunk and of its
+        //!             neighbours
+        void request(glm::ivec3 const& coord, size_t ticket, glm::vec3 const& center, float half_size,
+                     chunk_lod const& lod);
+
+        //! \brief Return the meshes finished since the last call.
+        std::vector<cpu_mesh> collect();
+
+        //! \brief Extract a chunk on the calling thread.
+        //!
+        //! Same parameters as `request()`.
+        cpu_mesh mesh(glm::ivec3 const& coord, size_t ticket, glm::vec3 const& center, float half_size,
+                      chunk_lod const& lod) const;
+
+        //! \brief Return the number of requests not collected yet.
+        size_t get_pending_nb() const { return _pending_nb.load(); }
+
+        //! \brief Return the number of worker threads.
+        size_t get_threads_nb() const { return _workers.GetThreadCount(); }
+
+        //! \brief Set the noise the density is made of.
+        //!
+        //! Extractions already running keep the previous noise: their
+        //! chunks should be requested again.
+        void set_noise(noise_kind noise) { _noise.store(noise); }
+
+        //! \brief Set the compiled density graph to evaluate.
+        //!
+        //! Until one is set, the density is 0 everywhere. As with
+        //! `set_noise()`, running extractions keep the previous graph.
+        void set_program(std::shared_ptr<density_program const> program);
+
+        //! \brief Set the baked tiles that chunks read their densities
+        //!        from, when they have one, rather than evaluating them.
+        //!
+        //! @param [in] tiles the tiles, which must outlive the mesher, or
+        //!             nullptr to always evaluate the density
+        void set_tiles(DensityTiles const* tiles) { _tiles.store(tiles); }
+
+    private:
+        int const* _edge_connections;
+        std::uint32_t _seed;
+        std::atomic<noise_kind> _noise;
+        mutable std::mutex _program_mutex;
+        std::shared_ptr<density_program const> _program;
+        std::atomic<DensityTiles const*> _tiles;
+        unsigned int _cells_nb;
+
+        std::mutex _finished_mutex;
+        std::vector<cpu_mesh> _finished;
+        std::atomic<size_t> _pending_nb;
+
+        // Declared last so that the workers are joined before anything
+        // they use gets destroyed.
+        ThreadPool _workers;
+    };
+}
@@ -0,0 +1,350 @@
+#include "density.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+    using edan35::density_instruction;
+    using edan35::density_op;
+    using edan35::density_program;
+
+    // Positions per instruction of the batched evaluation: the registers
+    // of a typical graph then stay in the L1 cache.
+    size_t const block_size = 64u;
+
+    // A value and its derivatives along x, y and z.
+    struct dual {
+        float value;
+        glm::vec3 gradient;
+
+        dual(float v = 0.0f, glm::vec3 const& g = glm::vec3(0.0f)) : value(v), gradient(g)
+        {
+        }
+    };
+
+    dual operator+(dual const& a, dual const& b) { return dual(a.value + b.value, a.gradient + b.gradient); }
+    dual operator-(dual const& a, dual const& b) { return dual(a.value - b.value, a.gradient - b.gradient); }
+    dual operator*(dual const& a, dual const& b) { return dual(a.value * b.value, a.gradient * b.value + b.gradient * a.value); }
+    dual operator-(dual const& a) { return dual(-a.value, -a.gradient); }
+
+    // Same choices as std::min() and std::max(), on the values.
+    float minimum(float a, float b) { return std::min(a, b); }
+    float maximum(float a, float b) { return std::max(a, b); }
+    dual minimum(dual const& a, dual const& b) { return b.value < a.value ? b : a; }
+    dual maximum(dual const& a, dual const& b) { return a.value < b.value ? b : a; }
+
+    template<typename Real>
+    struct position {
+        Real x, y, z;
+    };
+
+    position<float> world_position(glm::vec3 const& p, float /*tag*/)
+    {
+        return { p.x, p.y, p.z };
+    }
+
+    position<dual> world_position(glm::vec3 const& p, dual const& /*tag*/)
+    {
+        return { dual(p.x, glm::vec3(1.0f, 0.0f, 0.0f)), dual(p.y, glm::vec3(0.0f, 1.0f, 0.0f)), dual(p.z, glm::vec3(0.0f, 0.0f, 1.0f)) };
+    }
+
+    // `sample(position, channel)` returns an `edan35::noise_sample`.
+    template<typename Sample>
+    float octave_noise(position<float> const& p, float frequency, int channel, Sample const& sample)
+    {
+        return sample(glm::vec3(p.x * frequency, p.y * frequency, p.z * frequency), channel).value;
+    }
+
+    template<typename Sample>
+    dual octave_noise(position<dual> const& p, float frequency, int channel, Sample const& sample)
+    {
+        auto const s = sample(glm::vec3(p.x.value * frequency, p.y.value * frequency, p.z.value * frequency), channel);
+        auto const g = s.gradient * frequency;
+        return dual(s.value, p.x.gradient * g.x + p.y.gradient * g.y + p.z.gradient * g.z);
+    }
+
+    // Real is either float, or dual to carry the derivatives along.
+    template<typename Real, typename Sample>
+    Real evaluate(density_program const& program, glm::vec3 const& world_pos, Sample const& sample)
+    {
+        auto const& instructions = program.instructions;
+        if (instructions.empty())
+            return Real(0.0f);
+
+        // Every instruction gets a register of each type, only one of
+        // which is used.
+        std::vector<Real> scalars(instructions.size());
+        std::vector<position<Real>> positions(instructions.size());
+        for (size_t i = 0u; i < instructions.size(); ++i) {
+            auto const& in = instructions[i];
+            auto const a = static_cast<size_t>(std::max(in.a, 0));
+            auto const b = static_cast<size_t>(std::max(in.b, 0));
+            switch (in.op) {
+            case density_op::position:
+                positions[i] = world_position(world_pos, Real());
+                break;
+            case density_op::constant:
+                scalars[i] = Real(in.value);
+                break;
+            case density_op::add:
+                scalars[i] = scalars[a] + scalars[b];
+                break;
+            case density_op::subtract:
+                scalars[i] = scalars[a] - scalars[b];
+                break;
+            case density_op::multiply:
+                scalars[i] = scalars[a] * scalars[b];
+                break;
+            case density_op::minimum:
+                scalars[i] = minimum(scalars[a], scalars[b]);
+                break;
+            case density_op::maximum:
+                scalars[i] = maximum(scalars[a], scalars[b]);
+                break;
+            case density_op::negate:
+                scalars[i] = -scalars[a];
+                break;
+            case density_op::noise:
+                scalars[i] = octave_noise(positions[a], in.value, in.channel, sample);
+                break;
+            case density_op::warp: {
+                auto const offset = scalars[b] * Real(in.value);
+                positions[i] = { positions[a].x + offset, positions[a].y + offset, positions[a].z + offset };
+                break;
+            }
+            case density_op::sphere: {
+                auto const& p = positions[a];
+                scalars[i] = Real(in.value) - (p.x * p.x + p.y * p.y + p.z * p.z);
+                break;
+            }
+            case density_op::ground:
+                scalars[i] = Real(in.value) - positions[a].y;
+                break;
+            }
+        }
+        return scalars.back();
+    }
+
+    // An add whose operand is a noise, possibly multiplied by a constant,
+    // that nothing else reads: the batched evaluation then samples the
+    // noise into a scratch row and does the sum in the same loop, skipping
+    // the noise and the multiply.
+    struct fused_noise {
+        int noise;    // index of the noise, or -1 if the add is not fused
+        int operand;  // index of the other operand of the add
+        float scale;  // constant multiplying the noise, 1 if none
+    };
+
+    std::vector<fused_noise> fuse_noises(std::vector<density_instruction> const& instructions, std::vector<bool>& skipped)
+    {
+        std::vector<int> uses(instructions.size(), 0);
+        for (auto const& in : instructions) {
+            if (in.a >= 0)
+                ++uses[static_cast<size_t>(in.a)];
+            if (in.b >= 0)
+                ++uses[static_cast<size_t>(in.b)];
+        }
+        auto const read_once = [&](int r, density_op op) {
+            return uses[static_cast<size_t>(r)] == 1 && instructions[static_cast<size_t>(r)].op == op;
+        };
+
+        std::vector<fused_noise> fusions(instructions.size(), { -1, -1, 1.0f });
+        skipped.assign(instructions.size(), false);
+        for (size_t r = 0u; r < instructions.size(); ++r) {
+            auto const& in = instructions[r];
+            if (in.op != density_op::add)
+                continue;
+            for (auto const& operands : { std::make_pair(in.b, in.a), std::make_pair(in.a, in.b) }) {
+                auto const term = operands.first;
+                if (read_once(term, density_op::noise)) {
+                    fusions[r] = { term, operands.second, 1.0f };
+                    skipped[static_cast<size_t>(term)] = true;
+                    break;
+                }
+                if (!read_once(term, density_op::multiply))
+                    continue;
+                auto const& product = instructions[static_cast<size_t>(term)];
+                auto const noise = read_once(product.a, density_op::noise) ? product.a : product.b;
+                auto const factor = noise == product.a ? product.b : product.a;
+                if (!read_once(noise, density_op::noise) || instructions[static_cast<size_t>(factor)].op != density_op::constant)
+                    continue;
+                fusions[r] = { noise, operands.second, instructions[static_cast<size_t>(factor)].value };
+                skipped[static_cast<size_t>(term)] = true;
+                skipped[static_cast<size_t>(noise)] = true;
+                break;
+            }
+        }
+        return fusions;
+    }
+
+    // `sample(xs, ys, zs, values, count, channel)` fills `values` with the
+    // noise at the given positions.
+    template<typename Sample>
+    void evaluate(density_program const& program, float const* xs, float const* ys, float const* zs,
+                  float* densities, size_t count, Sample const& sample)
+    {
+        auto const& instructions = program.instructions;
+        if (instructions.empty()) {
+            std::fill_n(densities, count, 0.0f);
+            return;
+        }
+
+        std::vector<bool> skipped;
+        auto const fusions = fuse_noises(instructions, skipped);
+
+        // Three rows per instruction: x, y and z for positions, only the
+        // first one for scalars. Positions are read in place rather than
+        // copied, and the last instruction, a scalar, is written straight
+        // to `densities`.
+        size_t const register_size = 3u * block_size;
+        std::vector<float> registers(instructions.size() * register_size);
+        std::vector<float const*> rows(3u * instructions.size());
+        for (size_t r = 0u; r < instructions.size(); ++r)
+            for (size_t k = 0u; k < 3u; ++k)
+                rows[3u * r + k] = registers.data() + r * register_size + k * block_size;
+        float px[block_size], py[block_size], pz[block_size], noise[block_size];
+
+        for (size_t first = 0u; first < count; first += block_size) {
+            auto const n = std::min(block_size, count - first);
+            auto const sample_noise = [&](density_instruction const& in, float* values) {
+                auto const p = rows.data() + 3u * static_cast<size_t>(in.a);
+                for (size_t i = 0u; i < n; ++i) {
+                    px[i] = p[0][i] * in.value;
+                    py[i] = p[1][i] * in.value;
+                    pz[i] = p[2][i] * in.value;
+                }
+                sample(px, py, pz, values, n, in.channel);
+            };
+            for (size_t r = 0u; r < instructions.size(); ++r) {
+                if (skipped[r])
+                    continue;
+                auto const& in = instructions[r];
+                auto const out = r + 1u == instructions.size() ? densities + first : registers.data() + r * register_size;
+                auto const a = rows.data() + 3u * static_cast<size_t>(std::max(in.a, 0));
+                auto const b = rows[3u * static_cast<size_t>(std::max(in.b, 0))];
+                auto const ax = a[0], ay = a[1], az = a[2];
+                switch (in.op) {
+                case density_op::position:
+                    rows[3u * r] = xs + first;
+                    rows[3u * r + 1u] = ys + first;
+                    rows[3u * r + 2u] = zs + first;
+                    break;
+                case density_op::constant:
+                    std::fill_n(out, n, in.value);
+                    break;
+                case density_op::add: {
+                    auto const& fused = fusions[r];
+                    if (fused.noise < 0) {
+                        for (size_t i = 0u; i < n; ++i)
+                            out[i] = ax[i] + b[i];
+                        break;
+                    }
+                    sample_noise(instructions[static_cast<size_t>(fused.noise)], noise);
+                    auto const x = rows[3u * static_cast<size_t>(fused.operand)];
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = x[i] + noise[i] * fused.scale;
+                    break;
+                }
+                case density_op::subtract:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = ax[i] - b[i];
+                    break;
+                case density_op::multiply:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = ax[i] * b[i];
+                    break;
+                case density_op::minimum:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = std::min(ax[i], b[i]);
+                    break;
+                case density_op::maximum:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = std::max(ax[i], b[i]);
+                    break;
+                case density_op::negate:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = -ax[i];
+                    break;
+                case density_op::noise:
+                    sample_noise(in, out);
+                    break;
+                case density_op::warp:
+                    for (size_t i = 0u; i < n; ++i) {
+                        auto const offset = b[i] * in.value;
+                        out[i] = ax[i] + offset;
+                        out[block_size + i] = ay[i] + offset;
+                        out[2u * block_size + i] = az[i] + offset;
+                    }
+                    break;
+                case density_op::sphere:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = in.value - (ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]);
+                    break;
+                case density_op::ground:
+                    for (size_t i = 0u; i < n; ++i)
+                        out[i] = in.value - ay[i];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+float
+edan35::density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                glm::vec3 const& world_pos)
+{
+    switch (noise) {
+    case noise_kind::filtered:
+        return evaluate<float>(program, world_pos, [seed](glm::vec3 const& position, int channel) {
+            return filtered_noise(position, channel, seed);
+        });
+    case noise_kind::gradient:
+        break;
+    }
+    return evaluate<float>(program, world_pos, [seed](glm::vec3 const& position, int /*channel*/) {
+        return gradient_noise(position, seed);
+    });
+}
+
+float
+edan35::density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                glm::vec3 const& world_pos, glm::vec3& gradient)
+{
+    dual result;
+    switch (noise) {
+    case noise_kind::filtered:
+        result = evaluate<dual>(program, world_pos, [seed](glm::vec3 const& position, int channel) {
+            return filtered_noise(position, channel, seed);
+        });
+        break;
+    case noise_kind::gradient:
+        result = evaluate<dual>(program, world_pos, [seed](glm::vec3 const& position, int /*channel*/) {
+            return gradient_noise(position, seed);
+        });
+        break;
+    }
+    gradient = result.gradient;
+    return result.value;
+}
+
+void
+edan35::density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                float const* xs, float const* ys, float const* zs, float* densities, size_t count)
+{
+    switch (noise) {
+    case noise_kind::filtered:
+        evaluate(program, xs, ys, zs, densities, count, [seed](float const* px, float const* py, float const* pz, float* values, size_t n, int channel) {
+            filtered_noise(seed, channel, px, py, pz, values, n);
+        });
+        return;
+    case noise_kind::gradient:
+        break;
+    }
+    evaluate(program, xs, ys, zs, densities, count, [seed](float const* px, float const* py, float const* pz, float* values, size_t n, int /*channel*/) {
+        gradient_noise(seed, px, py, pz, values, nullptr, nullptr, nullptr, n);
+    });
+}
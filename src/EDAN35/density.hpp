@@ -0,0 +1,62 @@
+#pragma once
+
+#include "density_graph.hpp"
+#include "noise.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace edan35
+{
+    //! \brief CPU version of `density()` as compiled from a density graph
+    //!        for `density.frag`.
+    //!
+    //! @param [in] program the compiled density graph
+    //! @param [in] seed seed of the noise, as set on `noise_seed`
+    //! @param [in] noise noise the octaves are made of, as set on
+    //!             `noise_mode`
+    //! @param [in] world_pos world-space position to evaluate
+    //! @return the terrain density; positive values are inside the
+    //!         ground
+    float density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                  glm::vec3 const& world_pos);
+
+    //! \brief CPU version of `density()`, along with its derivatives.
+    //!
+    //! The derivatives are propagated through every node of the graph
+    //! alongside the values, using the analytic derivatives of the noise.
+    //!
+    //! @param [in] program the compiled density graph
+    //! @param [in] seed seed of the noise, as set on `noise_seed`
+    //! @param [in] noise noise the octaves are made of, as set on
+    //!             `noise_mode`
+    //! @param [in] world_pos world-space position to evaluate
+    //! @param [out] gradient derivatives of the density along x, y and z,
+    //!              pointing towards the inside of the ground
+    //! @return the terrain density, the same as without the derivatives
+    float density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                  glm::vec3 const& world_pos, glm::vec3& gradient);
+
+    //! \brief Evaluate `density()` at many positions at once, through the
+    //!        batched noise functions.
+    //!
+    //! Every instruction of the program runs over a block of positions
+    //! before the next one, so that interpreting the graph costs little
+    //! per position. The results are the same as those of `density()`,
+    //! bit for bit.
+    //!
+    //! @param [in] program the compiled density graph
+    //! @param [in] seed seed of the noise, as set on `noise_seed`
+    //! @param [in] noise noise the octaves are made of, as set on
+    //!             `noise_mode`
+    //! @param [in] xs world-space x coordinates of the positions
+    //! @param [in] ys world-space y coordinates of the positions
+    //! @param [in] zs world-space z coordinates of the positions
+    //! @param [out] densities one density per position
+    //! @param [in] count number of positions
+    void density(density_program const& program, std::uint32_t seed, noise_kind noise,
+                 float const* xs, float const* ys, float const* zs, float* densities, size_t count);
+}
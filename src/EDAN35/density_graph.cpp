@@ -0,0 +1,368 @@
+#include "density_graph.hpp"
+#include "noise.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+
+namespace
+{
+    using edan35::density_instruction;
+    using edan35::density_op;
+
+    // Operands expected by an operation of the file: `p` for a position
+    // node, `s` for a scalar node or a number, `n` for a number.
+    struct operation {
+        char const* name;
+        density_op op;
+        char const* operands;
+    };
+    operation const operations[] = {
+        { "position",     density_op::position, ""    },
+        { "constant",     density_op::constant, "n"   },
+        { "add",          density_op::add,      "ss"  },
+        { "subtract",     density_op::subtract, "ss"  },
+        { "multiply",     density_op::multiply, "ss"  },
+        { "negate",       density_op::negate,   "s"   },
+        { "union",        density_op::maximum,  "ss"  },
+        { "intersection", density_op::minimum,  "ss"  },
+        { "difference",   density_op::minimum,  "ss"  }, // of a and the complement of b
+        { "noise",        density_op::noise,    "pnn" },
+        { "warp",         density_op::warp,     "psn" },
+        { "sphere",       density_op::sphere,   "pn"  },
+        { "ground",       density_op::ground,   "pn"  }
+    };
+
+    bool is_position(density_op op)
+    {
+        return op == density_op::position || op == density_op::warp;
+    }
+
+    density_instruction make_instruction(density_op op, int a = -1, int b = -1, float value = 0.0f, int channel = 0)
+    {
+        density_instruction instruction;
+        instruction.op = op;
+        instruction.a = a;
+        instruction.b = b;
+        instruction.value = value;
+        instruction.channel = channel;
+        return instruction;
+    }
+
+    bool parse_number(std::string const& token, float& value)
+    {
+        char* end = nullptr;
+        value = std::strtof(token.c_str(), &end);
+        return end != token.c_str() && *end == '\0' && std::isfinite(value);
+    }
+
+    // Shortest decimal form reading back as the same float, always with a
+    // decimal point or an exponent so that GLSL parses it as a float.
+    std::string to_glsl(float value)
+    {
+        char buffer[32];
+        for (int precision = 6; precision <= 9; ++precision) {
+            std::snprintf(buffer, sizeof(buffer), "%.*g", precision, static_cast<double>(value));
+            if (std::strtof(buffer, nullptr) == value)
+                break;
+        }
+        auto text = std::string(buffer);
+        if (text.find_first_of(".e") == std::string::npos)
+            text += ".0";
+        return text;
+    }
+
+    // Appends instructions while simplifying them: the returned index may
+    // be that of an earlier, equivalent instruction.
+    class builder {
+    public:
+        int emit(density_instruction instruction)
+        {
+            auto const a = instruction.a;
+            auto const b = instruction.b;
+            auto const is_constant = [this](int i, float value) {
+                return _instructions[static_cast<size_t>(i)].op == density_op::constant
+                    && _instructions[static_cast<size_t>(i)].value == value;
+            };
+
+            if (is_scalar_arithmetic(instruction.op) && is_constant_node(a) && (b < 0 || is_constant_node(b)))
+                return emit(make_instruction(density_op::constant, -1, -1, fold(instruction)));
+
+            switch (instruction.op) {
+            case density_op::add:
+                if (is_constant(a, 0.0f))
+                    return b;
+                if (is_constant(b, 0.0f))
+                    return a;
+                break;
+            case density_op::subtract:
+                if (is_constant(b, 0.0f))
+                    return a;
+                if (is_constant(a, 0.0f))
+                    return emit(make_instruction(density_op::negate, b));
+                break;
+            case density_op::multiply:
+                if (is_constant(a, 0.0f) || is_constant(b, 0.0f))
+                    return emit(make_instruction(density_op::constant, -1, -1, 0.0f));
+                if (is_constant(a, 1.0f))
+                    return b;
+                if (is_constant(b, 1.0f))
+                    return a;
+                break;
+            case density_op::minimum:
+            case density_op::maximum:
+                if (a == b)
+                    return a;
+                break;
+            case density_op::negate:
+                if (_instructions[static_cast<size_t>(a)].op == density_op::negate)
+                    return _instructions[static_cast<size_t>(a)].a;
+                break;
+            case density_op::warp:
+                if (instruction.value == 0.0f || is_constant(b, 0.0f))
+                    return a;
+                break;
+            default:
+                break;
+            }
+
+            for (size_t i = 0u; i < _instructions.size(); ++i) {
+                auto const& other = _instructions[i];
+                if (other.op == instruction.op && other.a == a && other.b == b
+                    && other.value == instruction.value && other.channel == instruction.channel)
+                    return static_cast<int>(i);
+            }
+            _instructions.push_back(instruction);
+            return static_cast<int>(_instructions.size()) - 1;
+        }
+
+        bool produces_position(int i) const
+        {
+            return is_position(_instructions[static_cast<size_t>(i)].op);
+        }
+
+        // Keep only what `output` depends on, renumbering the operands.
+        std::vector<density_instruction> extract(int output) const
+        {
+            std::vector<bool> is_used(_instructions.size(), false);
+            is_used[static_cast<size_t>(output)] = true;
+            for (auto i = output; i >= 0; --i) {
+                if (!is_used[static_cast<size_t>(i)])
+                    continue;
+                auto const& instruction = _instructions[static_cast<size_t>(i)];
+                if (instruction.a >= 0)
+                    is_used[static_cast<size_t>(instruction.a)] = true;
+                if (instruction.b >= 0)
+                    is_used[static_cast<size_t>(instruction.b)] = true;
+            }
+
+            std::vector<int> remapped(_instructions.size(), -1);
+            std::vector<density_instruction> instructions;
+            for (size_t i = 0u; i <= static_cast<size_t>(output); ++i) {
+                if (!is_used[i])
+                    continue;
+                auto instruction = _instructions[i];
+                if (instruction.a >= 0)
+                    instruction.a = remapped[static_cast<size_t>(instruction.a)];
+                if (instruction.b >= 0)
+                    instruction.b = remapped[static_cast<size_t>(instruction.b)];
+                remapped[i] = static_cast<int>(instructions.size());
+                instructions.push_back(instruction);
+            }
+            return instructions;
+        }
+
+    private:
+        static bool is_scalar_arithmetic(density_op op)
+        {
+            return op == density_op::add || op == density_op::subtract || op == density_op::multiply
+                || op == density_op::minimum || op == density_op::maximum || op == density_op::negate;
+        }
+
+        bool is_constant_node(int i) const
+        {
+            return _instructions[static_cast<size_t>(i)].op == density_op::constant;
+        }
+
+        // Same operations as the evaluation, so that folding does not
+        // change the result.
+        float fold(density_instruction const& instruction) const
+        {
+            auto const a = _instructions[static_cast<size_t>(instruction.a)].value;
+            auto const b = instruction.b >= 0 ? _instructions[static_cast<size_t>(instruction.b)].value : 0.0f;
+            switch (instruction.op) {
+            case density_op::add:      return a + b;
+            case density_op::subtract: return a - b;
+            case density_op::multiply: return a * b;
+            case density_op::minimum:  return std::min(a, b);
+            case density_op::maximum:  return std::max(a, b);
+            case density_op::negate:   return -a;
+            default:                   return 0.0f;
+            }
+        }
+
+        std::vector<density_instruction> _instructions;
+    };
+
+    std::string generate_glsl(std::vector<density_instruction> const& instructions, std::string const& path)
+    {
+        std::ostringstream glsl;
+        glsl << "#version 410\n"
+             << "\n"
+             << "// Generated by compile_density_graph() from " << path << "\n"
+             << "\n"
+             << "float octave_noise(vec3 p, int channel);\n"
+             << "\n"
+             << "float density(vec3 world_pos)\n"
+             << "{\n";
+        for (size_t i = 0u; i < instructions.size(); ++i) {
+            auto const& instruction = instructions[i];
+            auto const a = "n" + std::to_string(instruction.a);
+            auto const b = "n" + std::to_string(instruction.b);
+            auto const value = to_glsl(instruction.value);
+            glsl << "\t" << (is_position(instruction.op) ? "vec3" : "float") << " n" << i << " = ";
+            switch (instruction.op) {
+            case density_op::position: glsl << "world_pos"; break;
+            case density_op::constant: glsl << value; break;
+            case density_op::add:      glsl << a << " + " << b; break;
+            case density_op::subtract: glsl << a << " - " << b; break;
+            case density_op::multiply: glsl << a << " * " << b; break;
+            case density_op::minimum:  glsl << "min(" << a << ", " << b << ")"; break;
+            case density_op::maximum:  glsl << "max(" << a << ", " << b << ")"; break;
+            case density_op::negate:   glsl << "-" << a; break;
+            case density_op::noise:    glsl << "octave_noise(" << a << " * " << value << ", " << instruction.channel << ")"; break;
+            case density_op::warp:     glsl << a << " + " << b << " * " << value; break;
+            case density_op::sphere:   glsl << value << " - dot(" << a << ", " << a << ")"; break;
+            case density_op::ground:   glsl << value << " - " << a << ".y"; break;
+            }
+            glsl << ";\n";
+        }
+        glsl << "\treturn n" << instructions.size() - 1u << ";\n"
+             << "}\n";
+        return glsl.str();
+    }
+}
+
+bool
+edan35::compile_density_graph(std::string const& path, density_program& program)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LogError("Failed to open the density graph \"%s\"", path.c_str());
+        return false;
+    }
+
+    builder graph;
+    std::unordered_map<std::string, int> nodes;
+    auto output = -1;
+    std::string line;
+    for (unsigned int line_nb = 1u; std::getline(file, line); ++line_nb) {
+        auto const comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream tokens(line);
+        std::vector<std::string> words;
+        for (std::string word; tokens >> word;)
+            words.push_back(word);
+        if (words.empty())
+            continue;
+
+        auto const fail = [&path, line_nb](std::string const& message) {
+            LogError("%s:%u: %s", path.c_str(), line_nb, message.c_str());
+            return false;
+        };
+
+        if (output >= 0)
+            return fail("nothing may follow the output");
+        if (words[0] == "output") {
+            if (words.size() != 2u)
+                return fail("expected \"output NAME\"");
+            auto const node = nodes.find(words[1]);
+            if (node == nodes.end())
+                return fail("unknown node \"" + words[1] + "\"");
+            if (graph.produces_position(node->second))
+                return fail("the output must be a scalar");
+            output = node->second;
+            continue;
+        }
+
+        if (words.size() < 3u || words[1] != "=")
+            return fail("expected \"NAME = OPERATION ARGUMENTS...\" or \"output NAME\"");
+        float number;
+        if (parse_number(words[0], number) || words[0] == "output")
+            return fail("\"" + words[0] + "\" may not name a node");
+        if (nodes.count(words[0]) != 0u)
+            return fail("node \"" + words[0] + "\" is already defined");
+        operation const* desc = nullptr;
+        for (auto const& o : operations)
+            if (words[2] == o.name)
+                desc = &o;
+        if (desc == nullptr)
+            return fail("unknown operation \"" + words[2] + "\"");
+        auto const operands_nb = std::string(desc->operands).size();
+        if (words.size() != 3u + operands_nb)
+            return fail("\"" + words[2] + "\" takes " + std::to_string(operands_nb) + " arguments");
+
+        // Node operands go to `a` then `b`, numbers to `value` then
+        // `channel`.
+        int node_operands[2] = { -1, -1 };
+        float numbers[2] = { 0.0f, 0.0f };
+        size_t node_operands_nb = 0u, numbers_nb = 0u;
+        for (size_t i = 0u; i < operands_nb; ++i) {
+            auto const& word = words[3u + i];
+            auto const kind = desc->operands[i];
+            if (parse_number(word, number)) {
+                if (kind == 'p')
+                    return fail("argument " + std::to_string(i + 1u) + " must be a position node");
+                if (kind == 's')
+                    node_operands[node_operands_nb++] = graph.emit(make_instruction(density_op::constant, -1, -1, number));
+                else
+                    numbers[numbers_nb++] = number;
+                continue;
+            }
+            if (kind == 'n')
+                return fail("argument " + std::to_string(i + 1u) + " must be a number");
+            auto const node = nodes.find(word);
+            if (node == nodes.end())
+                return fail("unknown node \"" + word + "\"");
+            if (graph.produces_position(node->second) != (kind == 'p'))
+                return fail("argument " + std::to_string(i + 1u) + " must be a " + (kind == 'p' ? "position" : "scalar"));
+            node_operands[node_operands_nb++] = node->second;
+        }
+
+        auto instruction = make_instruction(desc->op, node_operands[0], node_operands[1], numbers[0]);
+        switch (desc->op) {
+        case density_op::noise:
+            if (numbers[1] != std::floor(numbers[1]) || numbers[1] < 0.0f || numbers[1] >= static_cast<float>(noise_channels_nb))
+                return fail("the channel must be an integer below " + std::to_string(noise_channels_nb));
+            instruction.channel = static_cast<int>(numbers[1]);
+            break;
+        case density_op::sphere:
+            instruction.value = numbers[0] * numbers[0];
+            break;
+        case density_op::minimum:
+            if (words[2] == "difference")
+                instruction.b = graph.emit(make_instruction(density_op::negate, instruction.b));
+            break;
+        default:
+            break;
+        }
+        nodes[words[0]] = graph.emit(instruction);
+    }
+
+    if (output < 0) {
+        LogError("%s: missing \"output NAME\"", path.c_str());
+        return false;
+    }
+
+    program.instructions = graph.extract(output);
+    program.glsl = generate_glsl(program.instructions, path);
+    return true;
+}
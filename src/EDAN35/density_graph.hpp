@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Operation of a compiled density graph.
+    //!
+    //! Scalar operations produce a float, the others a position.
+    enum class density_op : int {
+        position = 0, //!< world-space position being evaluated
+        constant,     //!< scalar `value`
+        add,          //!< scalar `a + b`
+        subtract,     //!< scalar `a - b`
+        multiply,     //!< scalar `a * b`
+        minimum,      //!< scalar `min(a, b)`, the intersection of two solids
+        maximum,      //!< scalar `max(a, b)`, the union of two solids
+        negate,       //!< scalar `-a`, the complement of a solid
+        noise,        //!< octave noise at position `a * value`, from channel `channel` of the filtered noise
+        warp,         //!< position `a` moved along the diagonal by scalar `b * value`
+        sphere,       //!< scalar `value - dot(a, a)`, with `value` the squared radius
+        ground        //!< scalar `value - a.y`, with `value` the height of the ground
+    };
+
+    //! \brief One node of a compiled density graph.
+    struct density_instruction {
+        density_op op;
+        int a;        //!< index of the first operand, or -1
+        int b;        //!< index of the second operand, or -1
+        float value;  //!< parameter of the operation
+        int channel;  //!< channel read by `noise`
+    };
+
+    //! \brief Density graph ready to be evaluated, on the CPU by
+    //!        `density()` and on the GPU by `glsl`.
+    struct density_program {
+        //! Operands come before the instructions using them, and the last
+        //! instruction is the density. The density of an empty program
+        //! is 0 everywhere.
+        std::vector<density_instruction> instructions;
+
+        //! Fragment shader defining `float density(vec3 world_pos)`, to
+        //! be linked with `density.frag`, which defines `octave_noise()`.
+        std::string glsl;
+    };
+
+    //! \brief Load a density graph and compile it.
+    //!
+    //! A graph is a text file defining one node per line, as
+    //! `NAME = OPERATION ARGUMENTS...`, and ending with `output NAME`;
+    //! `#` starts a comment. Arguments are names of earlier nodes, or
+    //! numbers for scalars. The operations are:
+    //!
+    //! - `position`: the world-space position being evaluated;
+    //! - `constant VALUE`;
+    //! - `add A B`, `subtract A B`, `multiply A B` and `negate A`;
+    //! - `union A B`, `intersection A B` and `difference A B`, on solids
+    //!   where the density is positive;
+    //! - `noise POSITION FREQUENCY CHANNEL`: one octave of the noise;
+    //!   `FREQUENCY` and `CHANNEL` must be numbers;
+    //! - `warp POSITION OFFSET AMPLITUDE`: `POSITION` moved along the
+    //!   diagonal by `OFFSET * AMPLITUDE`; `AMPLITUDE` must be a number;
+    //! - `sphere POSITION RADIUS`: positive inside a sphere centred on the
+    //!   origin, growing with the squared distance; `RADIUS` must be a
+    //!   number;
+    //! - `ground POSITION HEIGHT`: positive below the plane y = `HEIGHT`;
+    //!   `HEIGHT` must be a number.
+    //!
+    //! Operations on constants are folded, operations whose result does
+    //! not depend on one of their operands (adding 0, multiplying by 0 or
+    //! 1, warping by 0) are replaced by their result, identical nodes are
+    //! merged, and nodes the output does not depend on are dropped: an
+    //! octave whose amplitude is set to 0 costs nothing.
+    //!
+    //! @param [in] path path to the graph file
+    //! @param [out] program the compiled graph; left untouched on failure
+    //! @return whether the graph could be read and compiled, errors being
+    //!         logged otherwise
+    bool compile_density_graph(std::string const& path, density_program& program);
+}
@@ -0,0 +1,241 @@
+#include "density_pass.hpp"
+
+#include "helpers.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/opengl.hpp"
+#include "core/various.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+
+edan35::DensityPass::DensityPass(unsigned int cells_nb)
+    : _cells_nb(cells_nb), _noise(noise_kind::gradient), _textures(), _tiles(), _fbo(0u), _locations()
+{
+    glGenFramebuffers(1, &_fbo);
+    assert(_fbo != 0u);
+}
+
+edan35::DensityPass::~DensityPass()
+{
+    clear_tiles();
+    glDeleteFramebuffers(1, &_fbo);
+    _fbo = 0u;
+}
+
+void
+edan35::DensityPass::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+    if (tex_id != 0u)
+        _textures.emplace_back(name, tex_id, type);
+}
+
+void
+edan35::DensityPass::add_tile(density_tile const& tile)
+{
+    GLenum internal_format = GL_NONE;
+    GLenum type = GL_NONE;
+    switch (tile.format) {
+    case tile_format::r16f:
+        internal_format = GL_R16F;
+        type = GL_HALF_FLOAT;
+        break;
+    case tile_format::r8_snorm:
+        internal_format = GL_R8_SNORM;
+        type = GL_BYTE;
+        break;
+    case tile_format::none:
+        LogError("Tile of chunk (%d, %d, %d) has no format", tile.coord.x, tile.coord.y, tile.coord.z);
+        return;
+    }
+
+    auto& textures = _tiles[tile.coord];
+    glDeleteTextures(static_cast<GLsizei>(textures.levels.size()), textures.levels.data());
+    textures.scales = tile.scales;
+    textures.levels.assign(tile.levels.size(), 0u);
+    glGenTextures(static_cast<GLsizei>(textures.levels.size()), textures.levels.data());
+
+    // Rows of an odd number of texels are not aligned on 4 bytes.
+    GLint unpack_alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0u; level < textures.levels.size(); ++level) {
+        assert(textures.levels[level] != 0u);
+        auto const size = static_cast<GLsizei>(get_cells_nb(static_cast<int>(level)) + 3u);
+        glBindTexture(GL_TEXTURE_3D, textures.levels[level]);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage3D(GL_TEXTURE_3D, 0, internal_format, size, size, size, 0, GL_RED, type, tile.levels[level].data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0u);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+}
+
+void
+edan35::DensityPass::clear_tiles()
+{
+    for (auto& tile : _tiles)
+        glDeleteTextures(static_cast<GLsizei>(tile.second.levels.size()), tile.second.levels.data());
+    _tiles.clear();
+}
+
+bool
+edan35::DensityPass::evaluate(GLuint program, glm::vec3 const& origin, float size, chunk& c)
+{
+    if (program == 0u)
+        return false;
+
+    auto const cells_nb = get_cells_nb(c.lod.level);
+    auto const corners_nb = cells_nb + 3u;
+    auto const step = size / static_cast<float>(cells_nb);
+    if (c.density_tex == 0u || c.density_corners_nb != corners_nb)
+        allocate(c, corners_nb);
+
+    // The pass may run in the middle of a frame: restore what it changes.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint polygon_mode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygon_mode);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, static_cast<GLsizei>(corners_nb), static_cast<GLsizei>(corners_nb));
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    glUseProgram(program);
+    update_locations(program);
+    glUniform3fv(_locations.lattice_origin, 1, glm::value_ptr(origin));
+    glUniform1f(_locations.lattice_step, step);
+    glUniform1i(_locations.lattice_cells, static_cast<GLint>(cells_nb));
+    GLint face_ratios[6];
+    for (size_t i = 0u; i < 6u; ++i)
+        face_ratios[i] = c.lod.get_face_ratio(i);
+    glUniform1iv(_locations.face_ratios, 6, face_ratios);
+    GLint edge_ratios[12];
+    for (size_t i = 0u; i < 12u; ++i)
+        edge_ratios[i] = c.lod.get_edge_ratio(i);
+    glUniform1iv(_locations.edge_ratios, 12, edge_ratios);
+    glUniform1i(_locations.noise_mode, static_cast<GLint>(_noise));
+    for (size_t i = 0u; i < _textures.size(); ++i) {
+        auto const& texture = _textures[i];
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(std::get<2>(texture), std::get<1>(texture));
+        glUniform1i(_locations.textures[i], static_cast<GLint>(i));
+    }
+    auto const tile = _tiles.find(c.coord);
+    auto const use_tile = tile != _tiles.end() && static_cast<size_t>(c.lod.level) < tile->second.levels.size();
+    glUniform1i(_locations.use_tile, use_tile ? 1 : 0);
+    if (use_tile) {
+        auto const unit = static_cast<GLint>(_textures.size());
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+        glBindTexture(GL_TEXTURE_3D, tile->second.levels[static_cast<size_t>(c.lod.level)]);
+        glUniform1i(_locations.tile_t, unit);
+        glUniform1f(_locations.tile_scale, tile->second.scales[static_cast<size_t>(c.lod.level)]);
+    }
+
+    auto succeeded = true;
+    for (unsigned int layer = 0u; layer < corners_nb; ++layer) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, c.density_tex, 0, static_cast<GLint>(layer));
+        if (layer == 0u && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            LogError("Failed to attach the density texture of chunk (%d, %d, %d)", c.coord.x, c.coord.y, c.coord.z);
+            succeeded = false;
+            break;
+        }
+        glUniform1i(_locations.lattice_layer, static_cast<GLint>(layer));
+        eda221::drawFullscreen();
+    }
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0u, 0, 0);
+
+    glUseProgram(0u);
+    glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(polygon_mode[0]));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0u);
+
+    return succeeded;
+}
+
+GLuint
+edan35::DensityPass::create_program(density_program const& program)
+{
+    auto const vertex_shader = utils::opengl::shader::generate_shader(GL_VERTEX_SHADER, utils::slurp_file(config::shaders_path("TERRAINER/density.vert")));
+    auto const fragment_shader = utils::opengl::shader::generate_shader(GL_FRAGMENT_SHADER, utils::slurp_file(config::shaders_path("TERRAINER/density.frag")));
+    // A second fragment shader defines density(), called by the first.
+    auto const graph_shader = utils::opengl::shader::generate_shader(GL_FRAGMENT_SHADER, program.glsl);
+
+    GLuint id = 0u;
+    if (vertex_shader != 0u && fragment_shader != 0u && graph_shader != 0u)
+        id = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader, graph_shader });
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    glDeleteShader(graph_shader);
+    return id;
+}
+
+void
+edan35::DensityPass::update_locations(GLuint program)
+{
+    auto const link_id = utils::opengl::shader::get_link_id(program);
+    if (program == _locations.program && link_id == _locations.link_id && _locations.textures.size() == _textures.size())
+        return;
+
+    _locations.program = program;
+    _locations.link_id = link_id;
+    _locations.lattice_origin = glGetUniformLocation(program, "lattice_origin");
+    _locations.lattice_step = glGetUniformLocation(program, "lattice_step");
+    _locations.lattice_cells = glGetUniformLocation(program, "lattice_cells");
+    _locations.lattice_layer = glGetUniformLocation(program, "lattice_layer");
+    _locations.face_ratios = glGetUniformLocation(program, "face_ratios");
+    _locations.edge_ratios = glGetUniformLocation(program, "edge_ratios");
+    _locations.noise_mode = glGetUniformLocation(program, "noise_mode");
+    _locations.use_tile = glGetUniformLocation(program, "use_tile");
+    _locations.tile_t = glGetUniformLocation(program, "tile_t");
+    _locations.tile_scale = glGetUniformLocation(program, "tile_scale");
+    _locations.textures.clear();
+    for (auto const& texture : _textures)
+        _locations.textures.push_back(glGetUniformLocation(program, std::get<0>(texture).c_str()));
+}
+
+unsigned int
+edan35::DensityPass::get_cells_nb(int level) const
+{
+    return std::max(_cells_nb >> level, 1u);
+}
+
+void
+edan35::DensityPass::release(chunk& c)
+{
+    glDeleteTextures(1, &c.density_tex);
+    c.density_tex = 0u;
+    c.density_corners_nb = 0u;
+}
+
+void
+edan35::DensityPass::allocate(chunk& c, unsigned int corners_nb)
+{
+    auto const created = c.density_tex == 0u;
+    if (created) {
+        glGenTextures(1, &c.density_tex);
+        assert(c.density_tex != 0u);
+    }
+    glBindTexture(GL_TEXTURE_3D, c.density_tex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    auto const size = static_cast<GLsizei>(corners_nb);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, size, size, size, 0, GL_RED, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0u);
+    c.density_corners_nb = corners_nb;
+
+    // Pool slots keep their texture for their whole lifetime, so the
+    // binding only needs to be set up once.
+    if (created)
+        c.node.add_texture("density_t", c.density_tex, GL_TEXTURE_3D);
+}
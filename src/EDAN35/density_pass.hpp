@@ -0,0 +1,137 @@
+#pragma once
+
+#include "chunk_manager.hpp"
+#include "density_graph.hpp"
+#include "density_tiles.hpp"
+#include "noise.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Evaluates the density function once per corner of a chunk's
+    //!        cell grid, into a 3D texture owned by the chunk.
+    //!
+    //! Neighbouring cells share their corners, so polygonising from this
+    //! lattice instead of sampling the density in every cell divides the
+    //! number of evaluations by about eight. The lattice extends one corner
+    //! beyond the chunk on every side, so that normals can be computed by
+    //! central differences everywhere in the chunk. Layers of the texture
+    //! are rendered one at a time, as OpenGL 4.1 has no compute shaders.
+    //!
+    //! The resolution of the lattice follows the level of detail of the
+    //! chunk, and faces and edges shared with coarser chunks are
+    //! resampled from the coarser lattice, see `chunk_lod`. Chunks with a
+    //! baked tile copy their lattice from it rather than evaluating the
+    //! density graph.
+    class DensityPass {
+    public:
+        //! \brief Create a density pass.
+        //!
+        //! @param [in] cells_nb number of cells along each chunk edge at the
+        //!             finest level of detail; the lattice has three more
+        //!             corners than that per axis: one to close the last
+        //!             cell, and one apron corner on each side
+        DensityPass(unsigned int cells_nb);
+
+        //! \brief Release the framebuffer used for rendering, and the
+        //!        tiles.
+        ~DensityPass();
+
+        DensityPass(DensityPass const&) = delete;
+        DensityPass& operator=(DensityPass const&) = delete;
+
+        //! \brief Add a texture that the density program samples.
+        //!
+        //! @param [in] name the sampler name used by the program
+        //! @param [in] tex_id the name of the OpenGL texture
+        //! @param [in] type the type of texture
+        void add_texture(std::string const& name, GLuint tex_id, GLenum type);
+
+        //! \brief Set the noise the density is made of, passed to the
+        //!        program as `noise_mode`.
+        //!
+        //! The filtered noise samples `noise_t`, which should have been
+        //! added with `add_texture()`.
+        void set_noise(noise_kind noise) { _noise = noise; }
+
+        //! \brief Upload a baked tile, one 3D texture per level of detail.
+        //!
+        //! Its chunk then samples the tile, passed to the program as
+        //! `tile_t` and `tile_scale`, rather than evaluating the density;
+        //! a tile uploaded earlier for the same chunk is replaced.
+        void add_tile(density_tile const& tile);
+
+        //! \brief Release all uploaded tiles.
+        void clear_tiles();
+
+        //! \brief Fill the density texture of a chunk at its level of
+        //!        detail, (re)creating the texture if needed.
+        //!
+        //! The texture is also bound as `density_t` on the chunk's node.
+        //!
+        //! @param [in] program program made of `density.vert` and
+        //!             `density.frag`
+        //! @param [in] origin world-space position of the first corner of
+        //!             the chunk, excluding the apron
+        //! @param [in] size world-space length of a chunk edge
+        //! @param [in,out] c the chunk to evaluate
+        //! @return whether the evaluation succeeded
+        bool evaluate(GLuint program, glm::vec3 const& origin, float size, chunk& c);
+
+        //! \brief Release the density texture of a chunk.
+        static void release(chunk& c);
+
+        //! \brief Create the program evaluating a density graph, made of
+        //!        `density.vert`, `density.frag` and the GLSL of the graph.
+        //!
+        //! @param [in] program the compiled density graph
+        //! @return the name of the OpenGL program, or 0 on failure
+        static GLuint create_program(density_program const& program);
+
+        //! \brief Return the number of cells along each chunk edge at a
+        //!        given level of detail.
+        unsigned int get_cells_nb(int level) const;
+
+    private:
+        struct tile_textures {
+            std::vector<float> scales;
+            std::vector<GLuint> levels;
+        };
+
+        // Uniform locations in the program last evaluated with, looked up
+        // again when it changes or gets relinked.
+        struct uniform_locations {
+            GLuint program;
+            size_t link_id;
+            GLint lattice_origin;
+            GLint lattice_step;
+            GLint lattice_cells;
+            GLint lattice_layer;
+            GLint face_ratios;
+            GLint edge_ratios;
+            GLint noise_mode;
+            GLint use_tile;
+            GLint tile_t;
+            GLint tile_scale;
+            std::vector<GLint> textures; // in the order of _textures
+        };
+
+        void update_locations(GLuint program);
+        static void allocate(chunk& c, unsigned int corners_nb);
+
+        unsigned int _cells_nb;
+        noise_kind _noise;
+        std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+        std::unordered_map<glm::ivec3, tile_textures, chunk_coord_hash> _tiles;
+        GLuint _fbo;
+        uniform_locations _locations;
+    };
+}
@@ -0,0 +1,222 @@
+#include "density_tiles.hpp"
+
+#include "core/Profiler.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+    using edan35::tile_format;
+
+    // Texels are stored as bytes whatever their format, in the byte order
+    // of the machine, as OpenGL expects them.
+    void encode(tile_format format, float value, std::uint8_t* texel)
+    {
+        if (format == tile_format::r16f) {
+            auto half = glm::packHalf1x16(value);
+            // Densities too small to be represented would lose their
+            // sign, and cells would change their classification.
+            if (value > 0.0f && glm::unpackHalf1x16(half) <= 0.0f)
+                half = 0x0001u;
+            std::memcpy(texel, &half, sizeof(half));
+        } else {
+            auto snorm = glm::packSnorm1x8(value);
+            if (value > 0.0f && glm::unpackSnorm1x8(snorm) <= 0.0f)
+                snorm = 0x01u;
+            *texel = snorm;
+        }
+    }
+
+    float decode(tile_format format, std::uint8_t const* texel)
+    {
+        if (format == tile_format::r16f) {
+            std::uint16_t half;
+            std::memcpy(&half, texel, sizeof(half));
+            return glm::unpackHalf1x16(half);
+        }
+        return glm::unpackSnorm1x8(*texel);
+    }
+}
+
+size_t
+edan35::get_texel_size(tile_format format)
+{
+    switch (format) {
+    case tile_format::r16f:
+        return 2u;
+    case tile_format::r8_snorm:
+        return 1u;
+    case tile_format::none:
+        break;
+    }
+    return 0u;
+}
+
+edan35::density_tile
+edan35::bake_density_tile(density_program const& program, std::uint32_t seed, noise_kind noise,
+                          glm::ivec3 const& coord, glm::vec3 const& center, float half_size,
+                          unsigned int cells_nb, int levels_nb, tile_format format, float band)
+{
+    assert(format != tile_format::none && levels_nb > 0 && band > 0.0f);
+
+    density_tile tile;
+    tile.coord = coord;
+    tile.format = format;
+
+    // Same corners as in `CPUMesher::mesh()`, a slice at a time, so that
+    // a tile decodes to what the mesher would have evaluated.
+    std::vector<std::vector<float>> lattices(static_cast<size_t>(levels_nb));
+    for (int level = 0; level < levels_nb; ++level) {
+        auto const level_cells_nb = std::max(cells_nb >> level, 1u);
+        auto const step = 2.0f / static_cast<float>(level_cells_nb);
+        auto const corners_nb = level_cells_nb + 3u;
+        auto const plane_size = corners_nb * corners_nb;
+
+        std::vector<float> coords(corners_nb);
+        std::vector<float> xs(plane_size), ys(plane_size), zs(plane_size);
+        auto const axis_coords = [&coords, corners_nb, step, half_size](float center) {
+            for (unsigned int i = 0u; i < corners_nb; ++i)
+                coords[i] = center + half_size * ((-1.0f - step) + step * static_cast<float>(i));
+        };
+        axis_coords(center.x);
+        for (unsigned int j = 0u; j < corners_nb; ++j)
+            std::copy(coords.begin(), coords.end(), xs.begin() + j * corners_nb);
+        axis_coords(center.y);
+        for (unsigned int j = 0u; j < corners_nb; ++j)
+            std::fill_n(ys.begin() + j * corners_nb, corners_nb, coords[j]);
+        axis_coords(center.z);
+
+        auto& lattice = lattices[static_cast<size_t>(level)];
+        lattice.resize(plane_size * corners_nb);
+        for (unsigned int k = 0u; k < corners_nb; ++k) {
+            std::fill(zs.begin(), zs.end(), coords[k]);
+            density(program, seed, noise, xs.data(), ys.data(), zs.data(), lattice.data() + k * plane_size, plane_size);
+        }
+    }
+
+    // Cells, and the densities across them, double with every level.
+    auto const texel_size = get_texel_size(format);
+    tile.scales.resize(lattices.size());
+    tile.levels.resize(lattices.size());
+    for (size_t level = 0u; level < lattices.size(); ++level) {
+        tile.scales[level] = std::ldexp(band, static_cast<int>(level));
+        auto const inverse_scale = 1.0f / tile.scales[level];
+        auto const& lattice = lattices[level];
+        auto& texels = tile.levels[level];
+        texels.resize(lattice.size() * texel_size);
+        for (size_t i = 0u; i < lattice.size(); ++i)
+            encode(format, glm::clamp(lattice[i] * inverse_scale, -1.0f, 1.0f), texels.data() + i * texel_size);
+    }
+    return tile;
+}
+
+void
+edan35::decode_density_tile(density_tile const& tile, int level, float* densities)
+{
+    assert(level >= 0 && static_cast<size_t>(level) < tile.levels.size());
+    auto const texel_size = get_texel_size(tile.format);
+    auto const& texels = tile.levels[static_cast<size_t>(level)];
+    auto const scale = tile.scales[static_cast<size_t>(level)];
+    for (size_t i = 0u; i < texels.size() / texel_size; ++i)
+        densities[i] = decode(tile.format, texels.data() + i * texel_size) * scale;
+}
+
+edan35::DensityTiles::DensityTiles(float chunk_size, unsigned int cells_nb, int levels_nb, float band, size_t threads_nb)
+    : _chunk_size(chunk_size), _cells_nb(cells_nb), _levels_nb(levels_nb), _band(band),
+      _tiles_mutex(), _generation(0u), _tiles(), _finished(), _baked_size(0u), _pending_nb(0u),
+      _workers(threads_nb)
+{
+    assert(chunk_size > 0.0f && cells_nb > 0u && levels_nb > 0 && band > 0.0f);
+}
+
+edan35::DensityTiles::~DensityTiles()
+{
+    // Queued bakes are outdated by this, and return as soon as they start.
+    {
+        std::lock_guard<std::mutex> lock(_tiles_mutex);
+        ++_generation;
+    }
+    _workers.Wait();
+}
+
+void
+edan35::DensityTiles::bake(glm::ivec3 const& min_coord, glm::ivec3 const& max_coord,
+                           std::shared_ptr<density_program const> program, std::uint32_t seed, noise_kind noise,
+                           tile_format format)
+{
+    size_t generation;
+    {
+        std::lock_guard<std::mutex> lock(_tiles_mutex);
+        generation = ++_generation;
+        _tiles.clear();
+        _finished.clear();
+        _baked_size = 0u;
+    }
+    if (format == tile_format::none || program == nullptr)
+        return;
+
+    for (int x = min_coord.x; x <= max_coord.x; ++x)
+    for (int y = min_coord.y; y <= max_coord.y; ++y)
+    for (int z = min_coord.z; z <= max_coord.z; ++z) {
+        auto const coord = glm::ivec3(x, y, z);
+        ++_pending_nb;
+        _workers.Enqueue([this, generation, coord, program, seed, noise, format]() {
+            {
+                std::lock_guard<std::mutex> lock(_tiles_mutex);
+                if (generation != _generation) {
+                    --_pending_nb;
+                    return;
+                }
+            }
+
+            PROFILE_ZONE("Bake density tile");
+            // Same as `ChunkManager::get_chunk_origin()`.
+            auto const half_size = 0.5f * _chunk_size;
+            auto const origin = glm::vec3(static_cast<float>(coord.x) * _chunk_size,
+                                          static_cast<float>(coord.y) * _chunk_size,
+                                          static_cast<float>(coord.z) * _chunk_size);
+            auto const tile = std::make_shared<density_tile const>(
+                bake_density_tile(*program, seed, noise, coord, origin + glm::vec3(half_size), half_size,
+                                  _cells_nb, _levels_nb, format, _band));
+
+            std::lock_guard<std::mutex> lock(_tiles_mutex);
+            if (generation == _generation) {
+                _tiles[coord] = tile;
+                _finished.push_back(tile);
+                for (auto const& texels : tile->levels)
+                    _baked_size += texels.size();
+            }
+            --_pending_nb;
+        });
+    }
+}
+
+std::vector<std::shared_ptr<edan35::density_tile const>>
+edan35::DensityTiles::collect()
+{
+    std::vector<std::shared_ptr<density_tile const>> finished;
+    std::lock_guard<std::mutex> lock(_tiles_mutex);
+    finished.swap(_finished);
+    return finished;
+}
+
+std::shared_ptr<edan35::density_tile const>
+edan35::DensityTiles::find(glm::ivec3 const& coord) const
+{
+    std::lock_guard<std::mutex> lock(_tiles_mutex);
+    auto const it = _tiles.find(coord);
+    return it != _tiles.end() ? it->second : nullptr;
+}
+
+std::pair<size_t, size_t>
+edan35::DensityTiles::get_baked() const
+{
+    std::lock_guard<std::mutex> lock(_tiles_mutex);
+    return std::make_pair(_tiles.size(), _baked_size);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "chunk_manager.hpp"
+#include "density.hpp"
+
+#include "core/ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief How the densities of a tile are stored.
+    enum class tile_format : int {
+        none = 0,   //!< no tiles: the density is evaluated for every chunk
+        r16f,       //!< half floats, uploaded as `GL_R16F`
+        r8_snorm    //!< signed bytes, uploaded as `GL_R8_SNORM`
+    };
+
+    //! \brief Density lattices of one chunk, baked at every level of
+    //!        detail.
+    //!
+    //! Each lattice covers the same corners as those `DensityPass` and
+    //! `CPUMesher` evaluate for the chunk at that level, apron included,
+    //! before faces and edges shared with coarser chunks get resampled.
+    //! Texels hold the density divided by the scale of their level, and
+    //! clamped to [-1, 1].
+    struct density_tile {
+        glm::ivec3 coord;          //!< chunk the tile was baked for
+        tile_format format;        //!< `r16f` or `r8_snorm`
+        std::vector<float> scales; //!< per level, densities are the texels times the scale
+
+        //! One lattice per level of detail, finest first, with x varying
+        //! fastest, then y; a texel takes 2 bytes in `r16f`, 1 in
+        //! `r8_snorm`.
+        std::vector<std::vector<std::uint8_t>> levels;
+    };
+
+    //! \brief Return the number of bytes per texel of a tile format.
+    size_t get_texel_size(tile_format format);
+
+    //! \brief Evaluate and encode the density lattices of a chunk.
+    //!
+    //! Only densities close to the surface matter to the meshers, so they
+    //! are clamped to a band around it, which is then what the texels
+    //! resolve. The band is the same for every tile, so that neighbouring
+    //! tiles encode the corners of their common faces identically, and
+    //! doubles with every coarser level, as the cells do.
+    //!
+    //! @param [in] program the compiled density graph
+    //! @param [in] seed seed of the noise
+    //! @param [in] noise noise the octaves are made of
+    //! @param [in] coord coordinates of the chunk
+    //! @param [in] center world-space center of the chunk
+    //! @param [in] half_size half the length of a chunk edge
+    //! @param [in] cells_nb number of cells along each chunk edge, at the
+    //!             finest level of detail
+    //! @param [in] levels_nb number of levels of detail to bake
+    //! @param [in] format `r16f` or `r8_snorm`
+    //! @param [in] band densities are clamped to [-band, band] at the
+    //!             finest level of detail; it should cover a few cells'
+    //!             worth of the steepest gradient near the surface, for
+    //!             the normals
+    //! @return the baked tile
+    density_tile bake_density_tile(density_program const& program, std::uint32_t seed, noise_kind noise,
+                                   glm::ivec3 const& coord, glm::vec3 const& center, float half_size,
+                                   unsigned int cells_nb, int levels_nb, tile_format format, float band);
+
+    //! \brief Decode one lattice of a tile, the way the GPU samples it.
+    //!
+    //! @param [in] tile the tile to decode
+    //! @param [in] level level of detail of the lattice
+    //! @param [out] densities one density per texel of the lattice
+    void decode_density_tile(density_tile const& tile, int level, float* densities);
+
+    //! \brief Bakes the density of a static region of the world into
+    //!        tiles, on a pool of worker threads.
+    //!
+    //! Chunks covered by a tile read their densities from it instead of
+    //! evaluating the density graph, which trades a little memory, about
+    //! 100 kB per chunk in `r16f` and half that in `r8_snorm`, for the
+    //! noise evaluations. As with `CPUMesher`, no OpenGL call is made:
+    //! finished tiles are handed back through `collect()`, to be uploaded
+    //! by the thread owning the context. `find()` can be called from any
+    //! thread.
+    class DensityTiles {
+    public:
+        //! \brief Create a baker and start its worker threads.
+        //!
+        //! @param [in] chunk_size world-space length of a chunk edge
+        //! @param [in] cells_nb number of cells along each chunk edge, at
+        //!             the finest level of detail
+        //! @param [in] levels_nb number of levels of detail
+        //! @param [in] band band the densities are clamped to, see
+        //!             `bake_density_tile()`
+        //! @param [in] threads_nb number of worker threads, 0 to pick one
+        //!             based on the hardware
+        DensityTiles(float chunk_size, unsigned int cells_nb, int levels_nb, float band, size_t threads_nb = 0u);
+
+        //! \brief Drop the queued bakes, then stop the workers.
+        ~DensityTiles();
+
+        DensityTiles(DensityTiles const&) = delete;
+        DensityTiles& operator=(DensityTiles const&) = delete;
+
+        //! \brief Drop all tiles, and bake a box of chunks in the
+        //!        background.
+        //!
+        //! Tiles of an earlier bake still running are discarded; until
+        //! the new ones are done, `find()` returns none, and the chunks
+        //! are evaluated.
+        //!
+        //! @param [in] min_coord first chunk of the region
+        //! @param [in] max_coord last chunk of the region, included
+        //! @param [in] program the compiled density graph
+        //! @param [in] seed seed of the noise
+        //! @param [in] noise noise the octaves are made of
+        //! @param [in] format `r16f` or `r8_snorm`; `none` only drops the
+        //!             tiles
+        void bake(glm::ivec3 const& min_coord, glm::ivec3 const& max_coord,
+                  std::shared_ptr<density_program const> program, std::uint32_t seed, noise_kind noise,
+                  tile_format format);
+
+        //! \brief Return the tiles finished since the last call, or since
+        //!        the last `bake()`.
+        std::vector<std::shared_ptr<density_tile const>> collect();
+
+        //! \brief Return the tile of a chunk, or nullptr if it has none
+        //!        (yet).
+        std::shared_ptr<density_tile const> find(glm::ivec3 const& coord) const;
+
+        //! \brief Return the number of tiles still to be baked.
+        size_t get_pending_nb() const { return _pending_nb.load(); }
+
+        //! \brief Return the number of baked tiles, and their size in
+        //!        bytes.
+        std::pair<size_t, size_t> get_baked() const;
+
+    private:
+        float _chunk_size;
+        unsigned int _cells_nb;
+        int _levels_nb;
+        float _band;
+
+        mutable std::mutex _tiles_mutex;
+        size_t _generation; // bumped by every bake(), to recognise outdated tiles
+        std::unordered_map<glm::ivec3, std::shared_ptr<density_tile const>, chunk_coord_hash> _tiles;
+        std::vector<std::shared_ptr<density_tile const>> _finished;
+        size_t _baked_size;
+        std::atomic<size_t> _pending_nb;
+
+        // Declared last so that the workers are joined before anything
+        // they use gets destroyed.
+        ThreadPool _workers;
+    };
+}
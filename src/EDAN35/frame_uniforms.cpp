@@ -0,0 +1,45 @@
+#include "frame_uniforms.hpp"
+
+#include <cassert>
+
+
+constexpr GLuint edan35::FrameUniforms::binding;
+
+edan35::FrameUniforms::FrameUniforms() : _ubo(0u)
+{
+    static_assert(sizeof(frame_data) == 3u * sizeof(glm::vec4), "frame_data must match the std140 layout");
+
+    glGenBuffers(1, &_ubo);
+    assert(_ubo != 0u);
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_data), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+}
+
+edan35::FrameUniforms::~FrameUniforms()
+{
+    glDeleteBuffers(1, &_ubo);
+    _ubo = 0u;
+}
+
+void
+edan35::FrameUniforms::update(frame_data const& data)
+{
+    // Orphaning the storage, so that draws of the previous frame still
+    // reading it are not waited for.
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_data), &data, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, _ubo);
+}
+
+void
+edan35::FrameUniforms::bind_block(GLuint program)
+{
+    if (program == 0u)
+        return;
+
+    auto const index = glGetUniformBlockIndex(program, "frame_data");
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, index, binding);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+
+namespace edan35
+{
+    //! \brief Camera and light data shared by all terrain programs, laid
+    //!        out as the std140 `frame_data` uniform block.
+    struct frame_data {
+        glm::vec4 camera_position; //!< world-space position of the camera; w is unused
+        glm::vec4 light_position;  //!< world-space position of the light; w is unused
+        glm::vec4 light_ambient;
+    };
+
+    //! \brief Uniform buffer holding the `frame_data` block, updated once
+    //!        per frame rather than set on every program before every draw.
+    class FrameUniforms {
+    public:
+        //! \brief Uniform buffer binding point of the block.
+        static constexpr GLuint binding = 0u;
+
+        //! \brief Create the uniform buffer.
+        FrameUniforms();
+
+        //! \brief Release the uniform buffer.
+        ~FrameUniforms();
+
+        FrameUniforms(FrameUniforms const&) = delete;
+        FrameUniforms& operator=(FrameUniforms const&) = delete;
+
+        //! \brief Upload the data of the current frame, and bind the buffer
+        //!        to `binding`.
+        void update(frame_data const& data);
+
+        //! \brief Connect the `frame_data` block of a program to `binding`;
+        //!        only needed once after linking the program.
+        //!
+        //! Programs without such a block are left untouched.
+        static void bind_block(GLuint program);
+
+    private:
+        GLuint _ubo;
+    };
+}
@@ -0,0 +1,45 @@
+#include "frustum.hpp"
+
+
+edan35::Frustum::Frustum() : _planes()
+{
+    _planes.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+edan35::Frustum
+edan35::Frustum::from_world_to_clip(glm::mat4 const& world_to_clip)
+{
+    // glm matrices are column-major: gather the rows first.
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(world_to_clip[0][i], world_to_clip[1][i], world_to_clip[2][i], world_to_clip[3][i]);
+
+    Frustum frustum;
+    frustum._planes[0] = rows[3] + rows[0]; // left
+    frustum._planes[1] = rows[3] - rows[0]; // right
+    frustum._planes[2] = rows[3] + rows[1]; // bottom
+    frustum._planes[3] = rows[3] - rows[1]; // top
+    frustum._planes[4] = rows[3] + rows[2]; // near
+    frustum._planes[5] = rows[3] - rows[2]; // far
+    for (auto& plane : frustum._planes) {
+        auto const length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+bool
+edan35::Frustum::intersects(glm::vec3 const& min_corner, glm::vec3 const& max_corner) const
+{
+    for (auto const& plane : _planes) {
+        // The corner furthest along the normal is the last one to leave
+        // the inner side.
+        auto const corner = glm::vec3(plane.x >= 0.0f ? max_corner.x : min_corner.x,
+                                      plane.y >= 0.0f ? max_corner.y : min_corner.y,
+                                      plane.z >= 0.0f ? max_corner.z : min_corner.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+
+namespace edan35
+{
+    //! \brief The six planes bounding what a camera sees, used to reject
+    //!        volumes that are out of view.
+    class Frustum {
+    public:
+        //! \brief Create a frustum which contains everything.
+        Frustum();
+
+        //! \brief Extract the planes of a world-to-clip matrix.
+        //!
+        //! Uses the method from "Fast Extraction of Viewing Frustum Planes
+        //! from the World-View-Projection Matrix" (Gribb and Hartmann).
+        //!
+        //! @param [in] world_to_clip e.g. `FPSCamera::GetWorldToClipMatrix()`
+        //! @return the frustum, with planes pointing inwards in world space
+        static Frustum from_world_to_clip(glm::mat4 const& world_to_clip);
+
+        //! \brief Return whether an axis-aligned box is at least partly
+        //!        inside the frustum.
+        //!
+        //! The test is conservative: some boxes near the corners of the
+        //! frustum are reported as visible although they are not.
+        //!
+        //! @param [in] min_corner world-space corner with the lowest
+        //!             coordinates
+        //! @param [in] max_corner world-space corner with the highest
+        //!             coordinates
+        bool intersects(glm::vec3 const& min_corner, glm::vec3 const& max_corner) const;
+
+    private:
+        // (normal, distance) so that dot(normal, p) + distance >= 0 for
+        // points p on the inner side.
+        std::array<glm::vec4, 6> _planes;
+    };
+}
@@ -0,0 +1,260 @@
+#include "gpu_mesher.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace constant
+{
+    // Enough for a chunk with roughly one triangle in every other cell;
+    // buffers grow as needed on denser chunks.
+    constexpr size_t initial_mesh_capacity = 16384u * 3u * edan35::GPUMesher::vertex_size;
+}
+
+constexpr size_t edan35::GPUMesher::vertex_size;
+
+edan35::GPUMesher::GPUMesher(std::vector<eda221::mesh_data> const& point_grids)
+    : _point_grids(point_grids), _textures(), _locations()
+{
+}
+
+void
+edan35::GPUMesher::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+    if (tex_id != 0u)
+        _textures.emplace_back(name, tex_id, type);
+}
+
+bool
+edan35::GPUMesher::classify(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk& c)
+{
+    auto const level = static_cast<size_t>(c.lod.level);
+    if (program == 0u || level >= _point_grids.size() || _point_grids[level].vao == 0u)
+        return false;
+    auto const& point_grid = _point_grids[level];
+
+    if (c.active_cells.vao == 0u) {
+        glGenVertexArrays(1, &c.active_cells.vao);
+        assert(c.active_cells.vao != 0u);
+        glGenBuffers(1, &c.active_cells.bo);
+        assert(c.active_cells.bo != 0u);
+
+        glBindVertexArray(c.active_cells.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, c.active_cells.bo);
+        glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
+        glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+        glBindVertexArray(0u);
+        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+        c.active_cells.drawing_mode = GL_POINTS;
+
+        // The number of active cells stays on the GPU, for drawing them
+        // with glDrawTransformFeedback().
+        glGenTransformFeedbacks(1, &c.active_cells.transform_feedback);
+        assert(c.active_cells.transform_feedback != 0u);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, c.active_cells.transform_feedback);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0u, c.active_cells.bo);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+    }
+
+    // Every cell of the grid may be active: size the list for the worst
+    // case at this level of detail, so that nothing is ever dropped.
+    auto const capacity = point_grid.vertices_nb * sizeof(glm::vec3);
+    if (c.active_cells_capacity != capacity) {
+        glBindBuffer(GL_ARRAY_BUFFER, c.active_cells.bo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+        c.active_cells_capacity = capacity;
+    }
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    bind(program, set_uniforms, c);
+    glBindVertexArray(point_grid.vao);
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, c.active_cells.transform_feedback);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(point_grid.vertices_nb));
+    glEndTransformFeedback();
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+
+    glBindVertexArray(0u);
+    glUseProgram(0u);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    return true;
+}
+
+bool
+edan35::GPUMesher::extract(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk& c)
+{
+    if (program == 0u || c.active_cells.transform_feedback == 0u)
+        return false;
+
+    // The surface area, and so the triangle count, shrinks fourfold with
+    // every level of detail.
+    if (c.mesh.vao == 0u)
+        allocate(c, constant::initial_mesh_capacity >> (2 * c.lod.level));
+
+    if (c.extraction_queries[0] == 0u) {
+        glGenQueries(2, c.extraction_queries);
+        assert(c.extraction_queries[0] != 0u && c.extraction_queries[1] != 0u);
+    }
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    bind(program, set_uniforms, c);
+    glBindVertexArray(c.active_cells.vao);
+
+    // The query results are read by check_extraction() once available,
+    // rather than stalling until the extraction is done.
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, c.mesh.transform_feedback);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, c.extraction_queries[0]);
+    glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, c.extraction_queries[1]);
+    glBeginTransformFeedback(GL_TRIANGLES);
+    glDrawTransformFeedback(GL_POINTS, c.active_cells.transform_feedback);
+    glEndTransformFeedback();
+    glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+    c.extraction_pending = true;
+
+    glBindVertexArray(0u);
+    glUseProgram(0u);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    return true;
+}
+
+bool
+edan35::GPUMesher::check_extraction(chunk& c)
+{
+    if (!c.extraction_pending)
+        return false;
+
+    // The generated primitives query ended last.
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(c.extraction_queries[0], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available != GL_TRUE)
+        return false;
+
+    GLuint generated = 0u, written = 0u;
+    glGetQueryObjectuiv(c.extraction_queries[0], GL_QUERY_RESULT, &generated);
+    glGetQueryObjectuiv(c.extraction_queries[1], GL_QUERY_RESULT, &written);
+    c.extraction_pending = false;
+    if (written == generated)
+        return false;
+
+    auto capacity = c.mesh_capacity;
+    while (capacity < static_cast<size_t>(generated) * 3u * vertex_size)
+        capacity *= 2u;
+    allocate(c, capacity);
+    LogInfo("Chunk (%d, %d, %d) dropped %u triangles during extraction: growing its mesh to %u bytes",
+            c.coord.x, c.coord.y, c.coord.z, generated - written, static_cast<unsigned int>(capacity));
+    return true;
+}
+
+void
+edan35::GPUMesher::release(chunk& c)
+{
+    glDeleteTransformFeedbacks(1, &c.active_cells.transform_feedback);
+    c.active_cells.transform_feedback = 0u;
+    glDeleteBuffers(1, &c.active_cells.bo);
+    c.active_cells.bo = 0u;
+    glDeleteVertexArrays(1, &c.active_cells.vao);
+    c.active_cells.vao = 0u;
+    c.active_cells.vertices_nb = 0u;
+    c.active_cells_capacity = 0u;
+
+    glDeleteQueries(2, c.extraction_queries);
+    c.extraction_queries[0] = c.extraction_queries[1] = 0u;
+    c.extraction_pending = false;
+    glDeleteTransformFeedbacks(1, &c.mesh.transform_feedback);
+    c.mesh.transform_feedback = 0u;
+    glDeleteBuffers(1, &c.mesh.bo);
+    c.mesh.bo = 0u;
+    glDeleteVertexArrays(1, &c.mesh.vao);
+    c.mesh.vao = 0u;
+    c.mesh.vertices_nb = 0u;
+    c.mesh_capacity = 0u;
+}
+
+void
+edan35::GPUMesher::allocate(chunk& c, size_t capacity)
+{
+    if (c.mesh.vao == 0u) {
+        glGenVertexArrays(1, &c.mesh.vao);
+        assert(c.mesh.vao != 0u);
+        glGenBuffers(1, &c.mesh.bo);
+        assert(c.mesh.bo != 0u);
+
+        glBindVertexArray(c.mesh.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, c.mesh.bo);
+        glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
+        glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(vertex_size), reinterpret_cast<GLvoid const*>(0x0));
+        glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
+        glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(vertex_size), reinterpret_cast<GLvoid const*>(sizeof(glm::vec3)));
+        glBindVertexArray(0u);
+        c.mesh.drawing_mode = GL_TRIANGLES;
+
+        // Growing the buffer keeps its name, and so this binding.
+        glGenTransformFeedbacks(1, &c.mesh.transform_feedback);
+        assert(c.mesh.transform_feedback != 0u);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, c.mesh.transform_feedback);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0u, c.mesh.bo);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, c.mesh.bo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0u);
+    c.mesh_capacity = capacity;
+}
+
+void
+edan35::GPUMesher::bind(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk const& c) const
+{
+    glUseProgram(program);
+
+    set_uniforms(program);
+    auto const& locations = get_locations(program);
+    auto const world = c.node.get_transform();
+    glUniformMatrix4fv(locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(world));
+    glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(glm::mat4()));
+    for (size_t i = 0u; i < _textures.size(); ++i) {
+        auto const& texture = _textures[i];
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(std::get<2>(texture), std::get<1>(texture));
+        glUniform1i(locations.textures[i], static_cast<GLint>(i));
+    }
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(_textures.size()));
+    glBindTexture(GL_TEXTURE_3D, c.density_tex);
+    glUniform1i(locations.density_t, static_cast<GLint>(_textures.size()));
+}
+
+edan35::GPUMesher::uniform_locations const&
+edan35::GPUMesher::get_locations(GLuint program) const
+{
+    // Only the classification and extraction programs are ever bound.
+    auto it = std::find_if(_locations.begin(), _locations.end(),
+                           [program](uniform_locations const& locations) { return locations.program == program; });
+    auto const found = it != _locations.end();
+    if (!found)
+        it = _locations.insert(_locations.end(), uniform_locations{ program, 0u, -1, -1, -1, {} });
+
+    auto& locations = *it;
+    auto const link_id = utils::opengl::shader::get_link_id(program);
+    if (found && link_id == locations.link_id && locations.textures.size() == _textures.size())
+        return locations;
+
+    locations.link_id = link_id;
+    locations.vertex_model_to_world = glGetUniformLocation(program, "vertex_model_to_world");
+    locations.vertex_world_to_clip = glGetUniformLocation(program, "vertex_world_to_clip");
+    locations.density_t = glGetUniformLocation(program, "density_t");
+    locations.textures.clear();
+    for (auto const& texture : _textures)
+        locations.textures.push_back(glGetUniformLocation(program, std::get<0>(texture).c_str()));
+    return locations;
+}
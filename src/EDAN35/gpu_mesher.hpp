@@ -0,0 +1,112 @@
+#pragma once
+
+#include "chunk_manager.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Runs the marching-cubes geometry shader once per chunk and
+    //!        captures its triangles with transform feedback, so that
+    //!        static terrain can then be drawn as a regular mesh.
+    //!
+    //! Meshing is preceded by a classification pass which captures the
+    //! positions of the cells crossed by the surface, so that the
+    //! marching-cubes shader only runs on those; transform feedback does
+    //! the stream compaction. Their number never leaves the GPU: the
+    //! cells are drawn with `glDrawTransformFeedback()`.
+    //!
+    //! Captured vertices are interleaved as `(vertex, normal)`, both
+    //! `vec3` in the model space of the chunk.
+    class GPUMesher {
+    public:
+        //! \brief Create a mesher.
+        //!
+        //! @param [in] point_grids for each level of detail, one point per
+        //!             cell of a chunk, drawn as `GL_POINTS` to invoke the
+        //!             geometry shader
+        GPUMesher(std::vector<eda221::mesh_data> const& point_grids);
+
+        //! \brief Add a texture that the extraction program samples.
+        //!
+        //! @param [in] name the sampler name used by the program
+        //! @param [in] tex_id the name of the OpenGL texture
+        //! @param [in] type the type of texture
+        void add_texture(std::string const& name, GLuint tex_id, GLenum type);
+
+        //! \brief Fill the list of active cells of a chunk.
+        //!
+        //! The density texture of the chunk must be up-to-date, see
+        //! `DensityPass::evaluate()`. The cells are captured by the
+        //! transform feedback object of `c.active_cells`, which only the
+        //! GPU knows the size of.
+        //!
+        //! @param [in] program transform feedback program made of
+        //!             `marching.vert` and `classify.geo`, capturing
+        //!             `cell_position`
+        //! @param [in] set_uniforms function setting up the program's
+        //!             uniforms
+        //! @param [in,out] c the chunk to classify
+        //! @return whether the classification succeeded
+        bool classify(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk& c);
+
+        //! \brief Extract the triangles of a chunk into its mesh.
+        //!
+        //! Only the cells found by the last call to `classify()` are
+        //! polygonised. The mesh is captured by the transform feedback
+        //! object of `c.mesh`; whether it fit in the buffer is only known
+        //! a few frames later, see `check_extraction()`.
+        //!
+        //! @param [in] program transform feedback program, see
+        //!             `eda221::createTransformFeedbackProgram()`
+        //! @param [in] set_uniforms function setting up the program's
+        //!             uniforms
+        //! @param [in,out] c the chunk to extract
+        //! @return whether the extraction succeeded
+        bool extract(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk& c);
+
+        //! \brief Return whether the latest extraction of a chunk dropped
+        //!        triangles for lack of room, once its results are
+        //!        available; never waits for the GPU.
+        //!
+        //! The mesh buffer is then grown, so that extracting the chunk
+        //! again fits all of its triangles.
+        //!
+        //! @param [in,out] c the chunk to check
+        //! @return whether the chunk needs to be extracted again
+        static bool check_extraction(chunk& c);
+
+        //! \brief Release the OpenGL objects of a chunk mesh.
+        static void release(chunk& c);
+
+        //! \brief Size in bytes of one captured vertex.
+        static constexpr size_t vertex_size = 2u * sizeof(glm::vec3);
+
+    private:
+        // Uniform locations in one of the programs bound so far, looked up
+        // again once it gets relinked.
+        struct uniform_locations {
+            GLuint program;
+            size_t link_id;
+            GLint vertex_model_to_world;
+            GLint vertex_world_to_clip;
+            GLint density_t;
+            std::vector<GLint> textures; // in the order of _textures
+        };
+
+        void bind(GLuint program, std::function<void (GLuint)> const& set_uniforms, chunk const& c) const;
+        uniform_locations const& get_locations(GLuint program) const;
+        static void allocate(chunk& c, size_t capacity);
+
+        std::vector<eda221::mesh_data> _point_grids;
+        std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+        mutable std::vector<uniform_locations> _locations; // by program
+    };
+}
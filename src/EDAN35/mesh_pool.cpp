@@ -0,0 +1,283 @@
+#include "mesh_pool.hpp"
+#include "gpu_mesher.hpp"
+
+#include "core/Log.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+
+constexpr GLuint edan35::MeshPool::transform_location;
+
+edan35::MeshPool::MeshPool(size_t vertices_nb, size_t indices_nb)
+    : _is_indirect(GLAD_GL_ARB_multi_draw_indirect != 0 && GLAD_GL_ARB_base_instance != 0), _vao(0u), _vertices_bo(0u),
+      _indices_bo(0u), _commands_bo(0u), _transforms_bo(0u), _vertices(vertices_nb), _indices(indices_nb), _commands(), _transforms()
+{
+    assert(vertices_nb > 0u && indices_nb > 0u);
+
+    glGenVertexArrays(1, &_vao);
+    assert(_vao != 0u);
+
+    glGenBuffers(1, &_vertices_bo);
+    assert(_vertices_bo != 0u);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _vertices_bo);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertices_nb * GPUMesher::vertex_size), nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &_indices_bo);
+    assert(_indices_bo != 0u);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _indices_bo);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indices_nb * sizeof(GLuint)), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+    if (_is_indirect) {
+        glGenBuffers(1, &_commands_bo);
+        assert(_commands_bo != 0u);
+        glGenBuffers(1, &_transforms_bo);
+        assert(_transforms_bo != 0u);
+    } else {
+        LogInfo("GL_ARB_multi_draw_indirect or GL_ARB_base_instance is not supported: pooled meshes will be drawn one by one");
+    }
+
+    bind_buffers();
+}
+
+edan35::MeshPool::~MeshPool()
+{
+    glDeleteBuffers(1, &_transforms_bo);
+    _transforms_bo = 0u;
+    glDeleteBuffers(1, &_commands_bo);
+    _commands_bo = 0u;
+    glDeleteBuffers(1, &_indices_bo);
+    _indices_bo = 0u;
+    glDeleteBuffers(1, &_vertices_bo);
+    _vertices_bo = 0u;
+    glDeleteVertexArrays(1, &_vao);
+    _vao = 0u;
+}
+
+void
+edan35::MeshPool::upload(pool_mesh& mesh, std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals,
+                         std::vector<GLuint> const& indices, StreamingBuffer& streaming)
+{
+    assert(vertices.size() == normals.size());
+
+    release(mesh);
+    if (vertices.empty() || indices.empty())
+        return;
+
+    auto const vertices_bo = _vertices_bo;
+    auto const indices_bo = _indices_bo;
+    allocate(_vertices, _vertices_bo, GPUMesher::vertex_size, vertices.size(), mesh.first_vertex);
+    allocate(_indices, _indices_bo, sizeof(GLuint), indices.size(), mesh.first_index);
+    if (_vertices_bo != vertices_bo || _indices_bo != indices_bo)
+        bind_buffers();
+    mesh.vertices_nb = vertices.size();
+    mesh.indices_nb = indices.size();
+
+    auto const vertices_size = vertices.size() * GPUMesher::vertex_size;
+    auto const vertices_offset = mesh.first_vertex * GPUMesher::vertex_size;
+    auto interleaved = static_cast<glm::vec3*>(streaming.begin_write(vertices_size));
+    std::vector<glm::vec3> fallback;
+    if (interleaved == nullptr) {
+        fallback.resize(2u * vertices.size());
+        interleaved = fallback.data();
+    }
+    for (size_t i = 0u; i < vertices.size(); ++i) {
+        interleaved[2u * i] = vertices[i];
+        interleaved[2u * i + 1u] = normals[i];
+    }
+    if (fallback.empty()) {
+        streaming.end_write(_vertices_bo, vertices_offset);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _vertices_bo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(vertices_offset), static_cast<GLsizeiptr>(vertices_size), fallback.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+    }
+
+    auto const indices_size = indices.size() * sizeof(GLuint);
+    auto const indices_offset = mesh.first_index * sizeof(GLuint);
+    auto const streamed_indices = streaming.begin_write(indices_size);
+    if (streamed_indices != nullptr) {
+        std::copy(indices.begin(), indices.end(), static_cast<GLuint*>(streamed_indices));
+        streaming.end_write(_indices_bo, indices_offset);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _indices_bo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(indices_offset), static_cast<GLsizeiptr>(indices_size), indices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+    }
+}
+
+void
+edan35::MeshPool::release(pool_mesh& mesh)
+{
+    if (mesh.vertices_nb > 0u)
+        _vertices.free(mesh.first_vertex, mesh.vertices_nb);
+    if (mesh.indices_nb > 0u)
+        _indices.free(mesh.first_index, mesh.indices_nb);
+    mesh = pool_mesh();
+}
+
+void
+edan35::MeshPool::add_draw(pool_mesh const& mesh, glm::vec4 const& transform)
+{
+    if (mesh.indices_nb == 0u)
+        return;
+
+    draw_elements_command command;
+    command.count = static_cast<GLuint>(mesh.indices_nb);
+    command.instance_count = 1u;
+    command.first_index = static_cast<GLuint>(mesh.first_index);
+    command.base_vertex = static_cast<GLint>(mesh.first_vertex);
+    command.base_instance = static_cast<GLuint>(_commands.size());
+    _commands.push_back(command);
+    _transforms.push_back(transform);
+}
+
+void
+edan35::MeshPool::draw()
+{
+    if (_commands.empty())
+        return;
+
+    glBindVertexArray(_vao);
+    if (_is_indirect) {
+        // Instance i of the only instance of draw i reads transform i.
+        glBindBuffer(GL_ARRAY_BUFFER, _transforms_bo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_transforms.size() * sizeof(glm::vec4)), _transforms.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commands_bo);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(_commands.size() * sizeof(draw_elements_command)), _commands.data(), GL_STREAM_DRAW);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0), static_cast<GLsizei>(_commands.size()), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+    } else {
+        for (size_t i = 0u; i < _commands.size(); ++i) {
+            auto const& command = _commands[i];
+            glVertexAttrib4fv(transform_location, glm::value_ptr(_transforms[i]));
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), GL_UNSIGNED_INT,
+                                     reinterpret_cast<GLvoid const*>(command.first_index * sizeof(GLuint)), command.base_vertex);
+        }
+    }
+    glBindVertexArray(0u);
+
+    _commands.clear();
+    _transforms.clear();
+}
+
+size_t
+edan35::MeshPool::get_used_size() const
+{
+    return _vertices.get_used() * GPUMesher::vertex_size + _indices.get_used() * sizeof(GLuint);
+}
+
+size_t
+edan35::MeshPool::get_capacity() const
+{
+    return _vertices.get_capacity() * GPUMesher::vertex_size + _indices.get_capacity() * sizeof(GLuint);
+}
+
+void
+edan35::MeshPool::allocate(free_list& list, GLuint& buffer, size_t element_size, size_t count, size_t& first)
+{
+    if (list.allocate(count, first))
+        return;
+
+    // Offsets of the meshes already in the buffer stay valid, and the
+    // room added at the end is enough on its own, however fragmented the
+    // rest is.
+    auto const capacity = std::max(2u * list.get_capacity(), list.get_capacity() + count);
+    LogInfo("Growing a mesh pool buffer to %u bytes", static_cast<unsigned int>(capacity * element_size));
+
+    GLuint grown = 0u;
+    glGenBuffers(1, &grown);
+    assert(grown != 0u);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity * element_size), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(list.get_capacity() * element_size));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+
+    list.grow(capacity);
+    list.allocate(count, first);
+}
+
+void
+edan35::MeshPool::bind_buffers() const
+{
+    glBindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertices_bo);
+    glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
+    glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(GPUMesher::vertex_size), reinterpret_cast<GLvoid const*>(0x0));
+    glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
+    glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(GPUMesher::vertex_size), reinterpret_cast<GLvoid const*>(sizeof(glm::vec3)));
+    if (_is_indirect) {
+        glBindBuffer(GL_ARRAY_BUFFER, _transforms_bo);
+        glEnableVertexAttribArray(transform_location);
+        glVertexAttribPointer(transform_location, 4, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(sizeof(glm::vec4)), reinterpret_cast<GLvoid const*>(0x0));
+        glVertexAttribDivisor(transform_location, 1u);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indices_bo);
+    glBindVertexArray(0u);
+    glBindBuffer(GL_ARRAY_BUFFER, 0u);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+}
+
+edan35::MeshPool::free_list::free_list(size_t capacity) : _free(), _capacity(capacity), _used(0u)
+{
+    _free.emplace(0u, capacity);
+}
+
+bool
+edan35::MeshPool::free_list::allocate(size_t count, size_t& first)
+{
+    for (auto it = _free.begin(); it != _free.end(); ++it) {
+        if (it->second < count)
+            continue;
+        first = it->first;
+        auto const left = it->second - count;
+        _free.erase(it);
+        if (left > 0u)
+            _free.emplace(first + count, left);
+        _used += count;
+        return true;
+    }
+    return false;
+}
+
+void
+edan35::MeshPool::free_list::free(size_t first, size_t count)
+{
+    assert(first + count <= _capacity && count <= _used);
+    _used -= count;
+
+    auto it = _free.emplace(first, count).first;
+    auto const next = std::next(it);
+    if (next != _free.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        _free.erase(next);
+    }
+    if (it != _free.begin()) {
+        auto const previous = std::prev(it);
+        if (previous->first + previous->second == it->first) {
+            previous->second += it->second;
+            _free.erase(it);
+        }
+    }
+}
+
+void
+edan35::MeshPool::free_list::grow(size_t capacity)
+{
+    assert(capacity >= _capacity);
+    if (capacity == _capacity)
+        return;
+    auto const old_capacity = _capacity;
+    _capacity = capacity;
+    _used += capacity - old_capacity;
+    free(old_capacity, capacity - old_capacity);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "streaming_buffer.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Where a mesh lives in a `MeshPool`.
+    struct pool_mesh {
+        size_t first_vertex; //!< index of the first vertex in the vertex buffer of the pool
+        size_t vertices_nb;  //!< number of vertices, 0 if the mesh holds nothing
+        size_t first_index;  //!< index of the first index in the index buffer of the pool
+        size_t indices_nb;   //!< number of indices, three per triangle
+
+        pool_mesh() : first_vertex(0u), vertices_nb(0u), first_index(0u), indices_nb(0u)
+        {
+        }
+    };
+
+    //! \brief Packs many indexed meshes into one vertex buffer and one
+    //!        index buffer, so that they can all be drawn with a single
+    //!        vertex array, program and draw call.
+    //!
+    //! Both buffers are sub-allocated with first-fit free lists, and double
+    //! in size when full. Vertices are laid out as in `GPUMesher`, in the
+    //! model space of their mesh; every draw places its mesh in the world
+    //! with a `vec4` holding a translation and a uniform scale, read from
+    //! attribute `transform_location`.
+    //!
+    //! With `GL_ARB_multi_draw_indirect` and `GL_ARB_base_instance`, the
+    //! draws of a frame are issued with one `glMultiDrawElementsIndirect()`
+    //! call, the transforms being per-instance attributes. Otherwise, they
+    //! are issued one `glDrawElementsBaseVertex()` at a time, setting the
+    //! transform as a constant attribute in between.
+    class MeshPool {
+    public:
+        //! \brief Attribute location of the per-draw transform.
+        static constexpr GLuint transform_location = 5u;
+
+        //! \brief Create the buffers of the pool.
+        //!
+        //! @param [in] vertices_nb initial capacity, in vertices
+        //! @param [in] indices_nb initial capacity, in indices
+        MeshPool(size_t vertices_nb, size_t indices_nb);
+
+        //! \brief Release the buffers of the pool.
+        ~MeshPool();
+
+        MeshPool(MeshPool const&) = delete;
+        MeshPool& operator=(MeshPool const&) = delete;
+
+        //! \brief Return whether draws are issued with a single indirect
+        //!        call.
+        bool is_indirect() const { return _is_indirect; }
+
+        //! \brief Replace the content of a mesh with a new indexed mesh.
+        //!
+        //! @param [in,out] mesh the mesh to replace
+        //! @param [in] vertices the vertices of the mesh
+        //! @param [in] normals one normal per vertex
+        //! @param [in] indices three consecutive indices per triangle
+        //! @param [in,out] streaming the staging ring to upload through
+        void upload(pool_mesh& mesh, std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals,
+                    std::vector<GLuint> const& indices, StreamingBuffer& streaming);
+
+        //! \brief Give the room used by a mesh back to the pool.
+        void release(pool_mesh& mesh);
+
+        //! \brief Queue a mesh for the next call to `draw()`.
+        //!
+        //! @param [in] mesh the mesh to draw
+        //! @param [in] transform world-space translation of the mesh, and
+        //!             its scale as fourth component
+        void add_draw(pool_mesh const& mesh, glm::vec4 const& transform);
+
+        //! \brief Draw the queued meshes with the current program, then
+        //!        empty the queue.
+        void draw();
+
+        //! \brief Return the number of bytes used by meshes, out of those
+        //!        allocated.
+        size_t get_used_size() const;
+
+        //! \brief Return the number of bytes allocated for both buffers.
+        size_t get_capacity() const;
+
+    private:
+        //! \brief First-fit allocator of ranges of elements, merging
+        //!        adjacent free ranges.
+        class free_list {
+        public:
+            free_list(size_t capacity);
+
+            //! \brief Reserve `count` consecutive elements.
+            //!
+            //! @param [out] first the first reserved element
+            //! @return whether there was room enough
+            bool allocate(size_t count, size_t& first);
+            void free(size_t first, size_t count);
+            void grow(size_t capacity);
+            size_t get_capacity() const { return _capacity; }
+            size_t get_used() const { return _used; }
+
+        private:
+            std::map<size_t, size_t> _free; // count of free elements, by first element
+            size_t _capacity;
+            size_t _used;
+        };
+
+        struct draw_elements_command {
+            GLuint count;
+            GLuint instance_count;
+            GLuint first_index;
+            GLint  base_vertex;
+            GLuint base_instance;
+        };
+
+        static void allocate(free_list& list, GLuint& buffer, size_t element_size, size_t count, size_t& first);
+        void bind_buffers() const;
+
+        bool _is_indirect;
+        GLuint _vao;
+        GLuint _vertices_bo;
+        GLuint _indices_bo;
+        GLuint _commands_bo;
+        GLuint _transforms_bo;
+        free_list _vertices;
+        free_list _indices;
+        std::vector<draw_elements_command> _commands;
+        std::vector<glm::vec4> _transforms;
+    };
+}
@@ -0,0 +1,852 @@
+#include "noise.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define NOISE_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+        // MSVC compiles intrinsics of any instruction set as is.
+#       define NOISE_TARGET(isa)
+#   else
+#       define NOISE_TARGET(isa) __attribute__((target(isa)))
+#   endif
+#endif
+
+
+namespace
+{
+    // Wrapping corners to the period is a mask, as it is a power of two.
+    static_assert((edan35::noise_period & (edan35::noise_period - 1)) == 0, "noise_period must be a power of two");
+    std::uint32_t const period_mask = static_cast<std::uint32_t>(edan35::noise_period - 1);
+
+    // Multipliers decorrelating the axes, then the finaliser of the hash;
+    // `density.frag` uses the same constants.
+    std::uint32_t const hash_x = 0x8da6b343u;
+    std::uint32_t const hash_y = 0xd8163841u;
+    std::uint32_t const hash_z = 0xcb1ab31fu;
+    std::uint32_t const hash_mix_1 = 0x7feb352du;
+    std::uint32_t const hash_mix_2 = 0x846ca68bu;
+
+    enum class isa { scalar, sse2, avx2, avx512 };
+
+    // Perlin's gradient selection, on the four lowest bits of the hash: u
+    // is x for the first 8 values and y otherwise, v is y for the first 4,
+    // x for 12 and 14, and z otherwise; bits 0 and 1 negate u and v.
+    void corner_gradient(std::uint32_t hash, float gradient[3])
+    {
+        auto const g = hash & 15u;
+        auto const su = (g & 1u) != 0u ? -1.0f : 1.0f;
+        auto const sv = (g & 2u) != 0u ? -1.0f : 1.0f;
+        auto const u_is_x = g < 8u;
+        auto const v_is_y = g < 4u;
+        auto const v_is_x = g == 12u || g == 14u;
+        gradient[0] = (u_is_x ? su : 0.0f) + (v_is_x ? sv : 0.0f);
+        gradient[1] = (u_is_x ? 0.0f : su) + (v_is_y ? sv : 0.0f);
+        gradient[2] = (v_is_y || v_is_x) ? 0.0f : sv;
+    }
+
+    // Coefficients of the trilinear blend of the eight corner values `c`,
+    // corner `k` lying at (k & 1, (k >> 1) & 1, (k >> 2) & 1): the blend is
+    // k0 + k1 x + k2 y + k3 z + k4 xy + k5 yz + k6 zx + k7 xyz.
+    void blend_coefficients(float const c[8], float k[8])
+    {
+        k[0] = c[0];
+        k[1] = c[1] - c[0];
+        k[2] = c[2] - c[0];
+        k[3] = c[4] - c[0];
+        k[4] = c[0] - c[1] - c[2] + c[3];
+        k[5] = c[0] - c[2] - c[4] + c[6];
+        k[6] = c[0] - c[1] - c[4] + c[5];
+        k[7] = c[1] - c[0] + c[2] - c[3] + c[4] - c[5] - c[6] + c[7];
+    }
+}
+
+std::uint32_t
+edan35::noise_hash(int x, int y, int z, std::uint32_t seed)
+{
+    auto hash = seed ^ ((static_cast<std::uint32_t>(x) & period_mask) * hash_x)
+                     ^ ((static_cast<std::uint32_t>(y) & period_mask) * hash_y)
+                     ^ ((static_cast<std::uint32_t>(z) & period_mask) * hash_z);
+    hash ^= hash >> 16;
+    hash *= hash_mix_1;
+    hash ^= hash >> 15;
+    hash *= hash_mix_2;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+edan35::noise_sample
+edan35::gradient_noise(glm::vec3 const& position, std::uint32_t seed)
+{
+    float const p[3] = { position.x, position.y, position.z };
+    int cell[3];
+    float f[3], f1[3], u[3], du[3];
+    for (int a = 0; a < 3; ++a) {
+        auto const floor = std::floor(p[a]);
+        cell[a] = static_cast<int>(floor);
+        f[a] = p[a] - floor;
+        f1[a] = f[a] - 1.0f;
+        // Quintic fade, and its derivative.
+        u[a] = f[a] * f[a] * f[a] * (f[a] * (f[a] * 6.0f - 15.0f) + 10.0f);
+        du[a] = 30.0f * f[a] * f[a] * (f[a] * (f[a] - 2.0f) + 1.0f);
+    }
+
+    float g[3][8], v[8];
+    for (int k = 0; k < 8; ++k) {
+        auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+        float gradient[3];
+        corner_gradient(noise_hash(cell[0] + ox, cell[1] + oy, cell[2] + oz, seed), gradient);
+        g[0][k] = gradient[0];
+        g[1][k] = gradient[1];
+        g[2][k] = gradient[2];
+        v[k] = gradient[0] * (ox != 0 ? f1[0] : f[0]) + gradient[1] * (oy != 0 ? f1[1] : f[1]) + gradient[2] * (oz != 0 ? f1[2] : f[2]);
+    }
+
+    auto const uxy = u[0] * u[1];
+    auto const uyz = u[1] * u[2];
+    auto const uzx = u[2] * u[0];
+    auto const uxyz = uxy * u[2];
+    auto const blend = [&u, uxy, uyz, uzx, uxyz](float const k[8]) {
+        return k[0] + u[0] * k[1] + u[1] * k[2] + u[2] * k[3] + uxy * k[4] + uyz * k[5] + uzx * k[6] + uxyz * k[7];
+    };
+
+    float kv[8];
+    blend_coefficients(v, kv);
+    // Derivatives of the blend weights, the gradients being constant.
+    float const partials[3] = {
+        kv[1] + u[1] * kv[4] + u[2] * kv[6] + uyz * kv[7],
+        kv[2] + u[0] * kv[4] + u[2] * kv[5] + uzx * kv[7],
+        kv[3] + u[1] * kv[5] + u[0] * kv[6] + uxy * kv[7]
+    };
+
+    noise_sample sample;
+    sample.value = 0.5f + 0.5f * blend(kv);
+    for (int a = 0; a < 3; ++a) {
+        float kg[8];
+        blend_coefficients(g[a], kg);
+        sample.gradient[a] = 0.5f * (blend(kg) + du[a] * partials[a]);
+    }
+    return sample;
+}
+
+#ifdef NOISE_X86
+namespace
+{
+    // The kernels below repeat the operations of the scalar version in the
+    // same order, so that each lane rounds exactly as it does.
+
+    NOISE_TARGET("sse2")
+    inline __m128i sse2_mullo(__m128i a, std::uint32_t b)
+    {
+        // SSE2 only multiplies the even lanes: multiply the odd ones
+        // separately, then interleave the low halves of the products.
+        auto const factor = _mm_set1_epi32(static_cast<int>(b));
+        auto const even = _mm_mul_epu32(a, factor);
+        auto const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), factor);
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // The hash of a corner xors one product per axis, and corners share
+    // them: each is computed once per cell, for both of its corners.
+    NOISE_TARGET("sse2")
+    inline __m128i sse2_hash_axis(__m128i coordinate, std::uint32_t multiplier)
+    {
+        return sse2_mullo(_mm_and_si128(coordinate, _mm_set1_epi32(static_cast<int>(period_mask))), multiplier);
+    }
+
+    NOISE_TARGET("sse2")
+    inline __m128i sse2_hash(__m128i x, __m128i y, __m128i z, __m128i seed)
+    {
+        auto hash = _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(seed, x), y), z);
+        hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 16));
+        hash = sse2_mullo(hash, hash_mix_1);
+        hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 15));
+        hash = sse2_mullo(hash, hash_mix_2);
+        return _mm_xor_si128(hash, _mm_srli_epi32(hash, 16));
+    }
+
+    // floor() out of a truncation, which rounds negative values up; the
+    // sign of p is kept for floor(-0) = -0.
+    NOISE_TARGET("sse2")
+    inline __m128 sse2_floor(__m128 p, __m128i& corner)
+    {
+        auto const truncated = _mm_cvttps_epi32(p);
+        auto const rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), p);
+        corner = _mm_add_epi32(truncated, _mm_castps_si128(rounded_up));
+        return _mm_or_ps(_mm_sub_ps(_mm_cvtepi32_ps(truncated), _mm_and_ps(rounded_up, _mm_set1_ps(1.0f))),
+                         _mm_and_ps(p, _mm_set1_ps(-0.0f)));
+    }
+
+    NOISE_TARGET("sse2")
+    inline __m128 sse2_select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // Dot product of the gradient of a corner with the offset to the
+    // position, when the gradient itself is not needed: its components are
+    // 0 or +-1, so the two non-zero products are exact, and only the sign
+    // of a zero sum may differ from the scalar version, which the blend
+    // then absorbs.
+    NOISE_TARGET("sse2")
+    inline __m128 sse2_contribution(__m128i hash, __m128 fx, __m128 fy, __m128 fz)
+    {
+        auto const g = _mm_and_si128(hash, _mm_set1_epi32(15));
+        auto const su = _mm_castsi128_ps(_mm_slli_epi32(g, 31));
+        auto const sv = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(g, 1), 31));
+        auto const u_is_x = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(8)));
+        auto const v_is_y = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(4)));
+        auto const v_is_x = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(g, _mm_set1_epi32(2)), _mm_set1_epi32(14)));
+        auto const u = _mm_xor_ps(sse2_select(u_is_x, fx, fy), su);
+        auto const v = _mm_xor_ps(sse2_select(v_is_y, fy, sse2_select(v_is_x, fx, fz)), sv);
+        return _mm_add_ps(u, v);
+    }
+
+    NOISE_TARGET("sse2")
+    inline void sse2_gradient(__m128i hash, __m128& gx, __m128& gy, __m128& gz)
+    {
+        auto const one = _mm_set1_ps(1.0f);
+        auto const g = _mm_and_si128(hash, _mm_set1_epi32(15));
+        auto const su = _mm_xor_ps(one, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(1)), 31)));
+        auto const sv = _mm_xor_ps(one, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(2)), 30)));
+        auto const u_is_x = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(8)));
+        auto const v_is_y = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(4)));
+        auto const v_is_x = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(g, _mm_set1_epi32(12)), _mm_cmpeq_epi32(g, _mm_set1_epi32(14))));
+        gx = _mm_add_ps(_mm_and_ps(u_is_x, su), _mm_and_ps(v_is_x, sv));
+        gy = _mm_add_ps(_mm_andnot_ps(u_is_x, su), _mm_and_ps(v_is_y, sv));
+        gz = _mm_andnot_ps(_mm_or_ps(v_is_y, v_is_x), sv);
+    }
+
+    NOISE_TARGET("sse2")
+    inline void sse2_coefficients(__m128 const c[8], __m128 k[8])
+    {
+        k[0] = c[0];
+        k[1] = _mm_sub_ps(c[1], c[0]);
+        k[2] = _mm_sub_ps(c[2], c[0]);
+        k[3] = _mm_sub_ps(c[4], c[0]);
+        k[4] = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(c[0], c[1]), c[2]), c[3]);
+        k[5] = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(c[0], c[2]), c[4]), c[6]);
+        k[6] = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(c[0], c[1]), c[4]), c[5]);
+        k[7] = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(_mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_sub_ps(c[1], c[0]), c[2]), c[3]), c[4]), c[5]), c[6]), c[7]);
+    }
+
+    NOISE_TARGET("sse2")
+    inline __m128 sse2_blend(__m128 const k[8], __m128 const u[3], __m128 uxy, __m128 uyz, __m128 uzx, __m128 uxyz)
+    {
+        auto value = _mm_add_ps(k[0], _mm_mul_ps(u[0], k[1]));
+        value = _mm_add_ps(value, _mm_mul_ps(u[1], k[2]));
+        value = _mm_add_ps(value, _mm_mul_ps(u[2], k[3]));
+        value = _mm_add_ps(value, _mm_mul_ps(uxy, k[4]));
+        value = _mm_add_ps(value, _mm_mul_ps(uyz, k[5]));
+        value = _mm_add_ps(value, _mm_mul_ps(uzx, k[6]));
+        return _mm_add_ps(value, _mm_mul_ps(uxyz, k[7]));
+    }
+
+    NOISE_TARGET("sse2")
+    inline __m128 sse2_partial(__m128 k_a, __m128 u_b, __m128 k_b, __m128 u_c, __m128 k_c, __m128 u_bc, __m128 k_7)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_add_ps(k_a, _mm_mul_ps(u_b, k_b)), _mm_mul_ps(u_c, k_c)), _mm_mul_ps(u_bc, k_7));
+    }
+
+    NOISE_TARGET("sse2")
+    size_t sse2_noise(std::uint32_t seed, float const* xs, float const* ys, float const* zs,
+                      float* values, float* dxs, float* dys, float* dzs, size_t count)
+    {
+        auto const one = _mm_set1_ps(1.0f);
+        auto const half = _mm_set1_ps(0.5f);
+        auto const seeds = _mm_set1_epi32(static_cast<int>(seed));
+
+        size_t i = 0u;
+        for (; i + 4u <= count; i += 4u) {
+            __m128 const p[3] = { _mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), _mm_loadu_ps(zs + i) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m128i cell[3], cell1[3];
+            __m128 f[3], f1[3], u[3], du[3];
+            for (int a = 0; a < 3; ++a) {
+                __m128i corner;
+                auto const floor = sse2_floor(p[a], corner);
+                cell[a] = sse2_hash_axis(corner, multipliers[a]);
+                cell1[a] = sse2_hash_axis(_mm_add_epi32(corner, _mm_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm_sub_ps(p[a], floor);
+                f1[a] = _mm_sub_ps(f[a], one);
+                u[a] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(f[a], f[a]), f[a]),
+                                  _mm_add_ps(_mm_mul_ps(f[a], _mm_sub_ps(_mm_mul_ps(f[a], _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)));
+                du[a] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(30.0f), f[a]), f[a]),
+                                   _mm_add_ps(_mm_mul_ps(f[a], _mm_sub_ps(f[a], _mm_set1_ps(2.0f))), one));
+            }
+
+            auto const uxy = _mm_mul_ps(u[0], u[1]);
+            auto const uyz = _mm_mul_ps(u[1], u[2]);
+            auto const uzx = _mm_mul_ps(u[2], u[0]);
+            auto const uxyz = _mm_mul_ps(uxy, u[2]);
+
+            __m128 g[3][8], v[8], kv[8];
+            if (dxs == nullptr) {
+                for (int k = 0; k < 8; ++k) {
+                    auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+                    v[k] = sse2_contribution(sse2_hash(ox != 0 ? cell1[0] : cell[0], oy != 0 ? cell1[1] : cell[1], oz != 0 ? cell1[2] : cell[2], seeds),
+                                             ox != 0 ? f1[0] : f[0], oy != 0 ? f1[1] : f[1], oz != 0 ? f1[2] : f[2]);
+                }
+                sse2_coefficients(v, kv);
+                _mm_storeu_ps(values + i, _mm_add_ps(half, _mm_mul_ps(half, sse2_blend(kv, u, uxy, uyz, uzx, uxyz))));
+                continue;
+            }
+
+            for (int k = 0; k < 8; ++k) {
+                auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+                sse2_gradient(sse2_hash(ox != 0 ? cell1[0] : cell[0], oy != 0 ? cell1[1] : cell[1], oz != 0 ? cell1[2] : cell[2], seeds),
+                              g[0][k], g[1][k], g[2][k]);
+                v[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(g[0][k], ox != 0 ? f1[0] : f[0]), _mm_mul_ps(g[1][k], oy != 0 ? f1[1] : f[1])),
+                                  _mm_mul_ps(g[2][k], oz != 0 ? f1[2] : f[2]));
+            }
+
+            sse2_coefficients(v, kv);
+            _mm_storeu_ps(values + i, _mm_add_ps(half, _mm_mul_ps(half, sse2_blend(kv, u, uxy, uyz, uzx, uxyz))));
+
+            __m128 const partials[3] = {
+                sse2_partial(kv[1], u[1], kv[4], u[2], kv[6], uyz, kv[7]),
+                sse2_partial(kv[2], u[0], kv[4], u[2], kv[5], uzx, kv[7]),
+                sse2_partial(kv[3], u[1], kv[5], u[0], kv[6], uxy, kv[7])
+            };
+            float* const derivatives[3] = { dxs, dys, dzs };
+            for (int a = 0; a < 3; ++a) {
+                __m128 kg[8];
+                sse2_coefficients(g[a], kg);
+                _mm_storeu_ps(derivatives[a] + i, _mm_mul_ps(half, _mm_add_ps(sse2_blend(kg, u, uxy, uyz, uzx, uxyz), _mm_mul_ps(du[a], partials[a]))));
+            }
+        }
+        return i;
+    }
+
+    NOISE_TARGET("sse2")
+    size_t sse2_filtered(std::uint32_t seed, int channel, float const* xs, float const* ys, float const* zs,
+                         float* values, size_t count)
+    {
+        auto const seeds = _mm_set1_epi32(static_cast<int>(seed));
+        auto const shift = _mm_cvtsi32_si128(8 * channel);
+
+        size_t i = 0u;
+        for (; i + 4u <= count; i += 4u) {
+            auto const texel_centre = _mm_set1_ps(0.5f);
+            __m128 const p[3] = { _mm_sub_ps(_mm_loadu_ps(xs + i), texel_centre), _mm_sub_ps(_mm_loadu_ps(ys + i), texel_centre),
+                                  _mm_sub_ps(_mm_loadu_ps(zs + i), texel_centre) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m128i cell[3], cell1[3];
+            __m128 f[3];
+            for (int a = 0; a < 3; ++a) {
+                __m128i corner;
+                auto const floor = sse2_floor(p[a], corner);
+                cell[a] = sse2_hash_axis(corner, multipliers[a]);
+                cell1[a] = sse2_hash_axis(_mm_add_epi32(corner, _mm_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm_sub_ps(p[a], floor);
+            }
+
+            __m128 c[8];
+            for (int k = 0; k < 8; ++k) {
+                auto const hash = sse2_hash((k & 1) != 0 ? cell1[0] : cell[0], ((k >> 1) & 1) != 0 ? cell1[1] : cell[1],
+                                            ((k >> 2) & 1) != 0 ? cell1[2] : cell[2], seeds);
+                c[k] = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(hash, shift), _mm_set1_epi32(0xff))), _mm_set1_ps(255.0f));
+            }
+
+            auto const fxy = _mm_mul_ps(f[0], f[1]);
+            __m128 k[8];
+            sse2_coefficients(c, k);
+            _mm_storeu_ps(values + i, sse2_blend(k, f, fxy, _mm_mul_ps(f[1], f[2]), _mm_mul_ps(f[2], f[0]), _mm_mul_ps(fxy, f[2])));
+        }
+        return i;
+    }
+
+    NOISE_TARGET("avx2")
+    inline __m256i avx2_hash_axis(__m256i coordinate, std::uint32_t multiplier)
+    {
+        return _mm256_mullo_epi32(_mm256_and_si256(coordinate, _mm256_set1_epi32(static_cast<int>(period_mask))),
+                                  _mm256_set1_epi32(static_cast<int>(multiplier)));
+    }
+
+    NOISE_TARGET("avx2")
+    inline __m256i avx2_hash(__m256i x, __m256i y, __m256i z, __m256i seed)
+    {
+        auto hash = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(seed, x), y), z);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+        hash = _mm256_mullo_epi32(hash, _mm256_set1_epi32(static_cast<int>(hash_mix_1)));
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 15));
+        hash = _mm256_mullo_epi32(hash, _mm256_set1_epi32(static_cast<int>(hash_mix_2)));
+        return _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+    }
+
+    NOISE_TARGET("avx2")
+    inline __m256 avx2_contribution(__m256i hash, __m256 fx, __m256 fy, __m256 fz)
+    {
+        auto const g = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+        auto const su = _mm256_castsi256_ps(_mm256_slli_epi32(g, 31));
+        auto const sv = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(g, 1), 31));
+        auto const u_is_x = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), g));
+        auto const v_is_y = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), g));
+        auto const v_is_x = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_or_si256(g, _mm256_set1_epi32(2)), _mm256_set1_epi32(14)));
+        auto const u = _mm256_xor_ps(_mm256_blendv_ps(fy, fx, u_is_x), su);
+        auto const v = _mm256_xor_ps(_mm256_blendv_ps(_mm256_blendv_ps(fz, fx, v_is_x), fy, v_is_y), sv);
+        return _mm256_add_ps(u, v);
+    }
+
+    NOISE_TARGET("avx2")
+    inline void avx2_gradient(__m256i hash, __m256& gx, __m256& gy, __m256& gz)
+    {
+        auto const one = _mm256_set1_ps(1.0f);
+        auto const g = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+        auto const su = _mm256_xor_ps(one, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(g, _mm256_set1_epi32(1)), 31)));
+        auto const sv = _mm256_xor_ps(one, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(g, _mm256_set1_epi32(2)), 30)));
+        auto const u_is_x = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), g));
+        auto const v_is_y = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), g));
+        auto const v_is_x = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(g, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(g, _mm256_set1_epi32(14))));
+        gx = _mm256_add_ps(_mm256_and_ps(u_is_x, su), _mm256_and_ps(v_is_x, sv));
+        gy = _mm256_add_ps(_mm256_andnot_ps(u_is_x, su), _mm256_and_ps(v_is_y, sv));
+        gz = _mm256_andnot_ps(_mm256_or_ps(v_is_y, v_is_x), sv);
+    }
+
+    NOISE_TARGET("avx2")
+    inline void avx2_coefficients(__m256 const c[8], __m256 k[8])
+    {
+        k[0] = c[0];
+        k[1] = _mm256_sub_ps(c[1], c[0]);
+        k[2] = _mm256_sub_ps(c[2], c[0]);
+        k[3] = _mm256_sub_ps(c[4], c[0]);
+        k[4] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(c[0], c[1]), c[2]), c[3]);
+        k[5] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(c[0], c[2]), c[4]), c[6]);
+        k[6] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(c[0], c[1]), c[4]), c[5]);
+        k[7] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(c[1], c[0]), c[2]), c[3]), c[4]), c[5]), c[6]), c[7]);
+    }
+
+    NOISE_TARGET("avx2")
+    inline __m256 avx2_blend(__m256 const k[8], __m256 const u[3], __m256 uxy, __m256 uyz, __m256 uzx, __m256 uxyz)
+    {
+        auto value = _mm256_add_ps(k[0], _mm256_mul_ps(u[0], k[1]));
+        value = _mm256_add_ps(value, _mm256_mul_ps(u[1], k[2]));
+        value = _mm256_add_ps(value, _mm256_mul_ps(u[2], k[3]));
+        value = _mm256_add_ps(value, _mm256_mul_ps(uxy, k[4]));
+        value = _mm256_add_ps(value, _mm256_mul_ps(uyz, k[5]));
+        value = _mm256_add_ps(value, _mm256_mul_ps(uzx, k[6]));
+        return _mm256_add_ps(value, _mm256_mul_ps(uxyz, k[7]));
+    }
+
+    NOISE_TARGET("avx2")
+    inline __m256 avx2_partial(__m256 k_a, __m256 u_b, __m256 k_b, __m256 u_c, __m256 k_c, __m256 u_bc, __m256 k_7)
+    {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(k_a, _mm256_mul_ps(u_b, k_b)), _mm256_mul_ps(u_c, k_c)), _mm256_mul_ps(u_bc, k_7));
+    }
+
+    NOISE_TARGET("avx2")
+    size_t avx2_noise(std::uint32_t seed, float const* xs, float const* ys, float const* zs,
+                      float* values, float* dxs, float* dys, float* dzs, size_t count)
+    {
+        auto const one = _mm256_set1_ps(1.0f);
+        auto const half = _mm256_set1_ps(0.5f);
+        auto const seeds = _mm256_set1_epi32(static_cast<int>(seed));
+
+        size_t i = 0u;
+        for (; i + 8u <= count; i += 8u) {
+            __m256 const p[3] = { _mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), _mm256_loadu_ps(zs + i) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m256i cell[3], cell1[3];
+            __m256 f[3], f1[3], u[3], du[3];
+            for (int a = 0; a < 3; ++a) {
+                auto const floor = _mm256_floor_ps(p[a]);
+                auto const corner = _mm256_cvttps_epi32(floor);
+                cell[a] = avx2_hash_axis(corner, multipliers[a]);
+                cell1[a] = avx2_hash_axis(_mm256_add_epi32(corner, _mm256_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm256_sub_ps(p[a], floor);
+                f1[a] = _mm256_sub_ps(f[a], one);
+                u[a] = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(f[a], f[a]), f[a]),
+                                     _mm256_add_ps(_mm256_mul_ps(f[a], _mm256_sub_ps(_mm256_mul_ps(f[a], _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f)));
+                du[a] = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30.0f), f[a]), f[a]),
+                                      _mm256_add_ps(_mm256_mul_ps(f[a], _mm256_sub_ps(f[a], _mm256_set1_ps(2.0f))), one));
+            }
+
+            auto const uxy = _mm256_mul_ps(u[0], u[1]);
+            auto const uyz = _mm256_mul_ps(u[1], u[2]);
+            auto const uzx = _mm256_mul_ps(u[2], u[0]);
+            auto const uxyz = _mm256_mul_ps(uxy, u[2]);
+
+            __m256 g[3][8], v[8], kv[8];
+            if (dxs == nullptr) {
+                for (int k = 0; k < 8; ++k) {
+                    auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+                    v[k] = avx2_contribution(avx2_hash(ox != 0 ? cell1[0] : cell[0], oy != 0 ? cell1[1] : cell[1], oz != 0 ? cell1[2] : cell[2], seeds),
+                                             ox != 0 ? f1[0] : f[0], oy != 0 ? f1[1] : f[1], oz != 0 ? f1[2] : f[2]);
+                }
+                avx2_coefficients(v, kv);
+                _mm256_storeu_ps(values + i, _mm256_add_ps(half, _mm256_mul_ps(half, avx2_blend(kv, u, uxy, uyz, uzx, uxyz))));
+                continue;
+            }
+
+            for (int k = 0; k < 8; ++k) {
+                auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+                avx2_gradient(avx2_hash(ox != 0 ? cell1[0] : cell[0], oy != 0 ? cell1[1] : cell[1], oz != 0 ? cell1[2] : cell[2], seeds),
+                              g[0][k], g[1][k], g[2][k]);
+                v[k] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(g[0][k], ox != 0 ? f1[0] : f[0]), _mm256_mul_ps(g[1][k], oy != 0 ? f1[1] : f[1])),
+                                     _mm256_mul_ps(g[2][k], oz != 0 ? f1[2] : f[2]));
+            }
+
+            avx2_coefficients(v, kv);
+            _mm256_storeu_ps(values + i, _mm256_add_ps(half, _mm256_mul_ps(half, avx2_blend(kv, u, uxy, uyz, uzx, uxyz))));
+
+            __m256 const partials[3] = {
+                avx2_partial(kv[1], u[1], kv[4], u[2], kv[6], uyz, kv[7]),
+                avx2_partial(kv[2], u[0], kv[4], u[2], kv[5], uzx, kv[7]),
+                avx2_partial(kv[3], u[1], kv[5], u[0], kv[6], uxy, kv[7])
+            };
+            float* const derivatives[3] = { dxs, dys, dzs };
+            for (int a = 0; a < 3; ++a) {
+                __m256 kg[8];
+                avx2_coefficients(g[a], kg);
+                _mm256_storeu_ps(derivatives[a] + i, _mm256_mul_ps(half, _mm256_add_ps(avx2_blend(kg, u, uxy, uyz, uzx, uxyz), _mm256_mul_ps(du[a], partials[a]))));
+            }
+        }
+        return i;
+    }
+
+    NOISE_TARGET("avx2")
+    size_t avx2_filtered(std::uint32_t seed, int channel, float const* xs, float const* ys, float const* zs,
+                         float* values, size_t count)
+    {
+        auto const seeds = _mm256_set1_epi32(static_cast<int>(seed));
+        auto const shift = _mm_cvtsi32_si128(8 * channel);
+
+        size_t i = 0u;
+        for (; i + 8u <= count; i += 8u) {
+            auto const texel_centre = _mm256_set1_ps(0.5f);
+            __m256 const p[3] = { _mm256_sub_ps(_mm256_loadu_ps(xs + i), texel_centre), _mm256_sub_ps(_mm256_loadu_ps(ys + i), texel_centre),
+                                  _mm256_sub_ps(_mm256_loadu_ps(zs + i), texel_centre) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m256i cell[3], cell1[3];
+            __m256 f[3];
+            for (int a = 0; a < 3; ++a) {
+                auto const floor = _mm256_floor_ps(p[a]);
+                auto const corner = _mm256_cvttps_epi32(floor);
+                cell[a] = avx2_hash_axis(corner, multipliers[a]);
+                cell1[a] = avx2_hash_axis(_mm256_add_epi32(corner, _mm256_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm256_sub_ps(p[a], floor);
+            }
+
+            __m256 c[8];
+            for (int k = 0; k < 8; ++k) {
+                auto const hash = avx2_hash((k & 1) != 0 ? cell1[0] : cell[0], ((k >> 1) & 1) != 0 ? cell1[1] : cell[1],
+                                            ((k >> 2) & 1) != 0 ? cell1[2] : cell[2], seeds);
+                c[k] = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(hash, shift), _mm256_set1_epi32(0xff))),
+                                     _mm256_set1_ps(255.0f));
+            }
+
+            auto const fxy = _mm256_mul_ps(f[0], f[1]);
+            __m256 k[8];
+            avx2_coefficients(c, k);
+            _mm256_storeu_ps(values + i, avx2_blend(k, f, fxy, _mm256_mul_ps(f[1], f[2]), _mm256_mul_ps(f[2], f[0]), _mm256_mul_ps(fxy, f[2])));
+        }
+        return i;
+    }
+
+    // GCC enables FMA along with AVX-512, and would then fuse the products
+    // and sums below, which rounds differently from the other paths.
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC push_options
+#   pragma GCC optimize("fp-contract=off")
+#endif
+
+    NOISE_TARGET("avx512f")
+    inline __m512i avx512_hash_axis(__m512i coordinate, std::uint32_t multiplier)
+    {
+        return _mm512_mullo_epi32(_mm512_and_si512(coordinate, _mm512_set1_epi32(static_cast<int>(period_mask))),
+                                  _mm512_set1_epi32(static_cast<int>(multiplier)));
+    }
+
+    NOISE_TARGET("avx512f")
+    inline __m512i avx512_hash(__m512i x, __m512i y, __m512i z, __m512i seed)
+    {
+        auto hash = _mm512_xor_si512(_mm512_xor_si512(_mm512_xor_si512(seed, x), y), z);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi32(hash, 16));
+        hash = _mm512_mullo_epi32(hash, _mm512_set1_epi32(static_cast<int>(hash_mix_1)));
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi32(hash, 15));
+        hash = _mm512_mullo_epi32(hash, _mm512_set1_epi32(static_cast<int>(hash_mix_2)));
+        return _mm512_xor_si512(hash, _mm512_srli_epi32(hash, 16));
+    }
+
+    NOISE_TARGET("avx512f")
+    inline __m512 avx512_contribution(__m512i hash, __m512 fx, __m512 fy, __m512 fz)
+    {
+        // Straight on the bits of the hash: u is x if bit 3 is clear, v is
+        // y if bits 2 and 3 are, and x for 12 and 14.
+        auto const sign = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+        auto const u_is_x = _mm512_testn_epi32_mask(hash, _mm512_set1_epi32(8));
+        auto const v_is_y = _mm512_testn_epi32_mask(hash, _mm512_set1_epi32(12));
+        auto const v_is_x = _mm512_cmpeq_epi32_mask(_mm512_and_si512(hash, _mm512_set1_epi32(13)), _mm512_set1_epi32(12));
+        auto const u = _mm512_castps_si512(_mm512_mask_blend_ps(u_is_x, fy, fx));
+        auto const v = _mm512_castps_si512(_mm512_mask_blend_ps(v_is_y, _mm512_mask_blend_ps(v_is_x, fz, fx), fy));
+        return _mm512_add_ps(_mm512_castsi512_ps(_mm512_mask_xor_epi32(u, _mm512_test_epi32_mask(hash, _mm512_set1_epi32(1)), u, sign)),
+                             _mm512_castsi512_ps(_mm512_mask_xor_epi32(v, _mm512_test_epi32_mask(hash, _mm512_set1_epi32(2)), v, sign)));
+    }
+
+    NOISE_TARGET("avx512f")
+    inline void avx512_coefficients(__m512 const c[8], __m512 k[8])
+    {
+        k[0] = c[0];
+        k[1] = _mm512_sub_ps(c[1], c[0]);
+        k[2] = _mm512_sub_ps(c[2], c[0]);
+        k[3] = _mm512_sub_ps(c[4], c[0]);
+        k[4] = _mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(c[0], c[1]), c[2]), c[3]);
+        k[5] = _mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(c[0], c[2]), c[4]), c[6]);
+        k[6] = _mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(c[0], c[1]), c[4]), c[5]);
+        k[7] = _mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(_mm512_add_ps(_mm512_sub_ps(_mm512_add_ps(_mm512_sub_ps(c[1], c[0]), c[2]), c[3]), c[4]), c[5]), c[6]), c[7]);
+    }
+
+    NOISE_TARGET("avx512f")
+    inline __m512 avx512_blend(__m512 const k[8], __m512 const u[3], __m512 uxy, __m512 uyz, __m512 uzx, __m512 uxyz)
+    {
+        auto value = _mm512_add_ps(k[0], _mm512_mul_ps(u[0], k[1]));
+        value = _mm512_add_ps(value, _mm512_mul_ps(u[1], k[2]));
+        value = _mm512_add_ps(value, _mm512_mul_ps(u[2], k[3]));
+        value = _mm512_add_ps(value, _mm512_mul_ps(uxy, k[4]));
+        value = _mm512_add_ps(value, _mm512_mul_ps(uyz, k[5]));
+        value = _mm512_add_ps(value, _mm512_mul_ps(uzx, k[6]));
+        return _mm512_add_ps(value, _mm512_mul_ps(uxyz, k[7]));
+    }
+
+    // Values only: the derivatives go through the AVX2 kernel.
+    NOISE_TARGET("avx512f")
+    size_t avx512_noise(std::uint32_t seed, float const* xs, float const* ys, float const* zs, float* values, size_t count)
+    {
+        auto const one = _mm512_set1_ps(1.0f);
+        auto const half = _mm512_set1_ps(0.5f);
+        auto const seeds = _mm512_set1_epi32(static_cast<int>(seed));
+
+        size_t i = 0u;
+        for (; i + 16u <= count; i += 16u) {
+            __m512 const p[3] = { _mm512_loadu_ps(xs + i), _mm512_loadu_ps(ys + i), _mm512_loadu_ps(zs + i) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m512i cell[3], cell1[3];
+            __m512 f[3], f1[3], u[3];
+            for (int a = 0; a < 3; ++a) {
+                auto const floor = _mm512_roundscale_ps(p[a], _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                auto const corner = _mm512_cvttps_epi32(floor);
+                cell[a] = avx512_hash_axis(corner, multipliers[a]);
+                cell1[a] = avx512_hash_axis(_mm512_add_epi32(corner, _mm512_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm512_sub_ps(p[a], floor);
+                f1[a] = _mm512_sub_ps(f[a], one);
+                u[a] = _mm512_mul_ps(_mm512_mul_ps(_mm512_mul_ps(f[a], f[a]), f[a]),
+                                     _mm512_add_ps(_mm512_mul_ps(f[a], _mm512_sub_ps(_mm512_mul_ps(f[a], _mm512_set1_ps(6.0f)), _mm512_set1_ps(15.0f))),
+                                                   _mm512_set1_ps(10.0f)));
+            }
+
+            __m512 v[8], kv[8];
+            for (int k = 0; k < 8; ++k) {
+                auto const ox = k & 1, oy = (k >> 1) & 1, oz = (k >> 2) & 1;
+                v[k] = avx512_contribution(avx512_hash(ox != 0 ? cell1[0] : cell[0], oy != 0 ? cell1[1] : cell[1], oz != 0 ? cell1[2] : cell[2], seeds),
+                                           ox != 0 ? f1[0] : f[0], oy != 0 ? f1[1] : f[1], oz != 0 ? f1[2] : f[2]);
+            }
+            auto const uxy = _mm512_mul_ps(u[0], u[1]);
+            avx512_coefficients(v, kv);
+            auto const value = avx512_blend(kv, u, uxy, _mm512_mul_ps(u[1], u[2]), _mm512_mul_ps(u[2], u[0]), _mm512_mul_ps(uxy, u[2]));
+            _mm512_storeu_ps(values + i, _mm512_add_ps(half, _mm512_mul_ps(half, value)));
+        }
+        return i;
+    }
+
+    NOISE_TARGET("avx512f")
+    size_t avx512_filtered(std::uint32_t seed, int channel, float const* xs, float const* ys, float const* zs,
+                           float* values, size_t count)
+    {
+        auto const seeds = _mm512_set1_epi32(static_cast<int>(seed));
+        auto const shift = _mm_cvtsi32_si128(8 * channel);
+
+        size_t i = 0u;
+        for (; i + 16u <= count; i += 16u) {
+            auto const texel_centre = _mm512_set1_ps(0.5f);
+            __m512 const p[3] = { _mm512_sub_ps(_mm512_loadu_ps(xs + i), texel_centre), _mm512_sub_ps(_mm512_loadu_ps(ys + i), texel_centre),
+                                  _mm512_sub_ps(_mm512_loadu_ps(zs + i), texel_centre) };
+            std::uint32_t const multipliers[3] = { hash_x, hash_y, hash_z };
+            __m512i cell[3], cell1[3];
+            __m512 f[3];
+            for (int a = 0; a < 3; ++a) {
+                auto const floor = _mm512_roundscale_ps(p[a], _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                auto const corner = _mm512_cvttps_epi32(floor);
+                cell[a] = avx512_hash_axis(corner, multipliers[a]);
+                cell1[a] = avx512_hash_axis(_mm512_add_epi32(corner, _mm512_set1_epi32(1)), multipliers[a]);
+                f[a] = _mm512_sub_ps(p[a], floor);
+            }
+
+            __m512 c[8];
+            for (int k = 0; k < 8; ++k) {
+                auto const hash = avx512_hash((k & 1) != 0 ? cell1[0] : cell[0], ((k >> 1) & 1) != 0 ? cell1[1] : cell[1],
+                                              ((k >> 2) & 1) != 0 ? cell1[2] : cell[2], seeds);
+                c[k] = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srl_epi32(hash, shift), _mm512_set1_epi32(0xff))),
+                                     _mm512_set1_ps(255.0f));
+            }
+
+            auto const fxy = _mm512_mul_ps(f[0], f[1]);
+            __m512 k[8];
+            avx512_coefficients(c, k);
+            _mm512_storeu_ps(values + i, avx512_blend(k, f, fxy, _mm512_mul_ps(f[1], f[2]), _mm512_mul_ps(f[2], f[0]), _mm512_mul_ps(fxy, f[2])));
+        }
+        return i;
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC pop_options
+#endif
+}
+#endif
+
+namespace
+{
+    isa detect_isa()
+    {
+#if defined(NOISE_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        auto const max_leaf = info[0];
+        __cpuid(info, 1);
+        auto const has_sse2 = (info[3] & (1 << 26)) != 0;
+        // AVX registers must also be saved by the OS.
+        auto const has_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+                          && (_xgetbv(0) & 0x6u) == 0x6u;
+        auto has_avx2 = false, has_avx512 = false;
+        if (has_avx && max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            has_avx2 = (info[1] & (1 << 5)) != 0;
+            // So must the mask and upper ZMM registers.
+            has_avx512 = has_avx2 && (info[1] & (1 << 16)) != 0 && (_xgetbv(0) & 0xe6u) == 0xe6u;
+        }
+        return has_avx512 ? isa::avx512 : has_avx2 ? isa::avx2 : has_sse2 ? isa::sse2 : isa::scalar;
+#elif defined(NOISE_X86)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") ? isa::avx512
+             : __builtin_cpu_supports("avx2") ? isa::avx2
+             : __builtin_cpu_supports("sse2") ? isa::sse2
+             : isa::scalar;
+#else
+        return isa::scalar;
+#endif
+    }
+
+    isa get_isa()
+    {
+        static isa const selected = detect_isa();
+        return selected;
+    }
+}
+
+void
+edan35::gradient_noise(std::uint32_t seed, float const* xs, float const* ys, float const* zs,
+                       float* values, float* dxs, float* dys, float* dzs, size_t count)
+{
+    size_t done = 0u;
+#ifdef NOISE_X86
+    switch (get_isa()) {
+    case isa::avx512:
+        done = dxs == nullptr ? avx512_noise(seed, xs, ys, zs, values, count)
+                              : avx2_noise(seed, xs, ys, zs, values, dxs, dys, dzs, count);
+        break;
+    case isa::avx2:
+        done = avx2_noise(seed, xs, ys, zs, values, dxs, dys, dzs, count);
+        break;
+    case isa::sse2:
+        done = sse2_noise(seed, xs, ys, zs, values, dxs, dys, dzs, count);
+        break;
+    case isa::scalar:
+        break;
+    }
+#endif
+    for (auto i = done; i < count; ++i) {
+        auto const sample = gradient_noise(glm::vec3(xs[i], ys[i], zs[i]), seed);
+        values[i] = sample.value;
+        if (dxs == nullptr)
+            continue;
+        dxs[i] = sample.gradient.x;
+        dys[i] = sample.gradient.y;
+        dzs[i] = sample.gradient.z;
+    }
+}
+
+std::vector<std::uint8_t>
+edan35::make_noise_texels(std::uint32_t seed)
+{
+    std::vector<std::uint8_t> texels(static_cast<size_t>(noise_period * noise_period * noise_period * noise_channels_nb));
+    auto texel = texels.begin();
+    for (int z = 0; z < noise_period; ++z)
+    for (int y = 0; y < noise_period; ++y)
+    for (int x = 0; x < noise_period; ++x) {
+        auto const hash = noise_hash(x, y, z, seed);
+        for (int c = 0; c < noise_channels_nb; ++c)
+            *texel++ = static_cast<std::uint8_t>(hash >> (8 * c));
+    }
+    return texels;
+}
+
+edan35::noise_sample
+edan35::filtered_noise(glm::vec3 const& position, int channel, std::uint32_t seed)
+{
+    // Texel centres lie halfway between integer coordinates.
+    float const p[3] = { position.x - 0.5f, position.y - 0.5f, position.z - 0.5f };
+    int cell[3];
+    float f[3];
+    for (int a = 0; a < 3; ++a) {
+        auto const floor = std::floor(p[a]);
+        cell[a] = static_cast<int>(floor);
+        f[a] = p[a] - floor;
+    }
+
+    float c[8];
+    for (int k = 0; k < 8; ++k) {
+        auto const hash = noise_hash(cell[0] + (k & 1), cell[1] + ((k >> 1) & 1), cell[2] + ((k >> 2) & 1), seed);
+        c[k] = static_cast<float>((hash >> (8 * channel)) & 0xffu) / 255.0f;
+    }
+
+    float k[8];
+    blend_coefficients(c, k);
+    noise_sample sample;
+    sample.value = k[0] + f[0] * k[1] + f[1] * k[2] + f[2] * k[3]
+                 + f[0] * f[1] * k[4] + f[1] * f[2] * k[5] + f[2] * f[0] * k[6] + f[0] * f[1] * f[2] * k[7];
+    sample.gradient = glm::vec3(k[1] + f[1] * k[4] + f[2] * k[6] + f[1] * f[2] * k[7],
+                                k[2] + f[0] * k[4] + f[2] * k[5] + f[2] * f[0] * k[7],
+                                k[3] + f[1] * k[5] + f[0] * k[6] + f[0] * f[1] * k[7]);
+    return sample;
+}
+
+void
+edan35::filtered_noise(std::uint32_t seed, int channel, float const* xs, float const* ys, float const* zs,
+                       float* values, size_t count)
+{
+    size_t done = 0u;
+#ifdef NOISE_X86
+    switch (get_isa()) {
+    case isa::avx512:
+        done = avx512_filtered(seed, channel, xs, ys, zs, values, count);
+        break;
+    case isa::avx2:
+        done = avx2_filtered(seed, channel, xs, ys, zs, values, count);
+        break;
+    case isa::sse2:
+        done = sse2_filtered(seed, channel, xs, ys, zs, values, count);
+        break;
+    case isa::scalar:
+        break;
+    }
+#endif
+    for (auto i = done; i < count; ++i)
+        values[i] = filtered_noise(glm::vec3(xs[i], ys[i], zs[i]), channel, seed).value;
+}
+
+char const*
+edan35::get_noise_isa()
+{
+    switch (get_isa()) {
+    case isa::avx512:
+        return "AVX-512";
+    case isa::avx2:
+        return "AVX2";
+    case isa::sse2:
+        return "SSE2";
+    case isa::scalar:
+        break;
+    }
+    return "scalar";
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Number of lattice cells after which the noise repeats, along
+    //!        each axis.
+    constexpr int noise_period = 32;
+
+    //! \brief Number of uncorrelated noises stored in `noise_t`, one per
+    //!        channel.
+    constexpr int noise_channels_nb = 4;
+
+    //! \brief Noise that the octaves of the density are made of; the
+    //!        values match `noise_mode` in `density.frag`.
+    enum class noise_kind : int {
+        gradient = 0, //!< `gradient_noise()`, computed from the hashes of the eight corners
+        filtered      //!< `filtered_noise()`, a single hardware-filtered fetch of `noise_t`
+    };
+
+    //! \brief Value of the noise at a position, and its derivatives.
+    struct noise_sample {
+        float value;        //!< in [0, 1]
+        glm::vec3 gradient; //!< derivatives of `value` along x, y and z
+    };
+
+    //! \brief Hash of a lattice corner, wrapped to `noise_period`; same as
+    //!        `noise_hash()` in `density.frag`.
+    //!
+    //! @param [in] x, y, z coordinates of the corner
+    //! @param [in] seed selects one of many uncorrelated noises
+    std::uint32_t noise_hash(int x, int y, int z, std::uint32_t seed);
+
+    //! \brief Seeded gradient noise with analytic derivatives; same as
+    //!        `gradient_noise()` in `density.frag`.
+    //!
+    //! Each lattice corner gets one of Perlin's twelve edge gradients,
+    //! picked by `noise_hash()`, and the corner contributions are blended
+    //! with a quintic fade, so that the derivatives are continuous. Only
+    //! integer operations depend on the seed, so the same seed gives the
+    //! same noise on the CPU and the GPU, up to floating-point rounding.
+    //!
+    //! @param [in] position where to sample the noise, in lattice cells
+    //! @param [in] seed selects one of many uncorrelated noises
+    //! @return the noise value, mapped to [0, 1], and its derivatives
+    noise_sample gradient_noise(glm::vec3 const& position, std::uint32_t seed);
+
+    //! \brief Sample `gradient_noise()` at many positions at once.
+    //!
+    //! Positions are processed 16 at a time with AVX-512, when `dxs` is
+    //! `nullptr`, 8 at a time with AVX2, or 4 at a time with SSE2,
+    //! depending on what the CPU supports; the remaining ones, and all of
+    //! them on other CPUs, go through the scalar version. All paths give
+    //! the same results, bit for bit.
+    //!
+    //! @param [in] seed selects one of many uncorrelated noises
+    //! @param [in] xs x coordinates of the positions, in lattice cells
+    //! @param [in] ys y coordinates of the positions, in lattice cells
+    //! @param [in] zs z coordinates of the positions, in lattice cells
+    //! @param [out] values one noise value per position
+    //! @param [out] dxs derivatives along x, or `nullptr` to skip all of
+    //!              the derivatives
+    //! @param [out] dys derivatives along y, ignored if `dxs` is `nullptr`
+    //! @param [out] dzs derivatives along z, ignored if `dxs` is `nullptr`
+    //! @param [in] count number of positions
+    void gradient_noise(std::uint32_t seed, float const* xs, float const* ys, float const* zs,
+                        float* values, float* dxs, float* dys, float* dzs, size_t count);
+
+    //! \brief Compute the texels of `noise_t`, the texture sampled by the
+    //!        filtered noise.
+    //!
+    //! The texture is `noise_period` texels wide along each axis, with x
+    //! varying fastest, and meant to be uploaded as `GL_RGBA8`: channel `c`
+    //! of a texel is byte `c` of the `noise_hash()` of the corner, so that
+    //! the CPU never needs to read the texture back.
+    //!
+    //! @param [in] seed selects one of many uncorrelated noises
+    //! @return `noise_channels_nb` bytes per texel
+    std::vector<std::uint8_t> make_noise_texels(std::uint32_t seed);
+
+    //! \brief Value noise as sampled by `texture()` on `noise_t`, with
+    //!        `GL_LINEAR` filtering and `GL_REPEAT` wrapping.
+    //!
+    //! The texels are trilinearly blended, so that the derivatives jump
+    //! across texel boundaries. GPUs blend with fewer bits of precision
+    //! than a float has, hence the CPU and the GPU only agree up to that
+    //! precision.
+    //!
+    //! @param [in] position where to sample the noise, in texels; the
+    //!             texture coordinates are `position / noise_period`
+    //! @param [in] channel channel of `noise_t` to sample, below
+    //!             `noise_channels_nb`
+    //! @param [in] seed seed `noise_t` was made with
+    //! @return the noise value, in [0, 1], and its derivatives
+    noise_sample filtered_noise(glm::vec3 const& position, int channel, std::uint32_t seed);
+
+    //! \brief Sample `filtered_noise()` at many positions at once.
+    //!
+    //! Positions are processed as by the batched `gradient_noise()`.
+    //!
+    //! @param [in] seed seed `noise_t` was made with
+    //! @param [in] channel channel of `noise_t` to sample
+    //! @param [in] xs x coordinates of the positions, in texels
+    //! @param [in] ys y coordinates of the positions, in texels
+    //! @param [in] zs z coordinates of the positions, in texels
+    //! @param [out] values one noise value per position
+    //! @param [in] count number of positions
+    void filtered_noise(std::uint32_t seed, int channel, float const* xs, float const* ys, float const* zs,
+                        float* values, size_t count);
+
+    //! \brief Return the name of the instruction set used by the batched
+    //!        `gradient_noise()`, i.e. "AVX-512", "AVX2", "SSE2" or
+    //!        "scalar".
+    char const* get_noise_isa();
+}
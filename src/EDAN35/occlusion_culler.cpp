@@ -0,0 +1,131 @@
+#include "occlusion_culler.hpp"
+
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cassert>
+
+
+edan35::OcclusionCuller::OcclusionCuller(float near_distance)
+    : _near_distance(near_distance), _box_vao(0u), _locations()
+{
+    // The box corners are computed from gl_VertexID, but core profiles
+    // still require a vertex array to be bound when drawing.
+    glGenVertexArrays(1, &_box_vao);
+    assert(_box_vao != 0u);
+}
+
+edan35::OcclusionCuller::~OcclusionCuller()
+{
+    glDeleteVertexArrays(1, &_box_vao);
+    _box_vao = 0u;
+}
+
+bool
+edan35::OcclusionCuller::is_occluded(chunk& c, ChunkManager const& chunks, glm::vec3 const& camera_position) const
+{
+    if (c.occlusion_pending) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(c.occlusion_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_TRUE) {
+            GLuint any_samples_passed = GL_FALSE;
+            glGetQueryObjectuiv(c.occlusion_query, GL_QUERY_RESULT, &any_samples_passed);
+            c.occluded = any_samples_passed == GL_FALSE;
+            c.occlusion_pending = false;
+        }
+    }
+
+    auto const margin = glm::vec3(_near_distance);
+    auto const min_corner = chunks.get_chunk_origin(c.coord) - margin;
+    auto const max_corner = min_corner + glm::vec3(chunks.get_chunk_size()) + 2.0f * margin;
+    auto const contains_camera = glm::all(glm::greaterThanEqual(camera_position, min_corner))
+                              && glm::all(glm::lessThanEqual(camera_position, max_corner));
+
+    return c.occluded && !contains_camera;
+}
+
+void
+edan35::OcclusionCuller::test(GLuint program, glm::mat4 const& world_to_clip, ChunkManager const& chunks,
+                              std::vector<chunk*> const& occluded) const
+{
+    if (program == 0u || occluded.empty())
+        return;
+
+    // The boxes must not hide anything, nor be altered by the wireframe
+    // mode: restore what is changed.
+    GLint polygon_mode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygon_mode);
+    GLboolean depth_mask = GL_TRUE;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+    auto const cull_face = glIsEnabled(GL_CULL_FACE);
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    glUseProgram(program);
+    update_locations(program);
+    glUniformMatrix4fv(_locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+
+    glBindVertexArray(_box_vao);
+    for (auto* c : occluded) {
+        // Starting a new query would discard the result of the pending
+        // one, which might then never be read if the GPU is constantly
+        // behind.
+        if (c->occlusion_pending)
+            continue;
+        if (c->occlusion_query == 0u) {
+            glGenQueries(1, &c->occlusion_query);
+            assert(c->occlusion_query != 0u);
+        }
+        auto const min_corner = chunks.get_chunk_origin(c->coord);
+        auto const max_corner = min_corner + glm::vec3(chunks.get_chunk_size());
+        glUniform3fv(_locations.box_min, 1, glm::value_ptr(min_corner));
+        glUniform3fv(_locations.box_max, 1, glm::value_ptr(max_corner));
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, c->occlusion_query);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        c->occlusion_pending = true;
+    }
+    glBindVertexArray(0u);
+    glUseProgram(0u);
+
+    if (cull_face == GL_TRUE)
+        glEnable(GL_CULL_FACE);
+    glDepthMask(depth_mask);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(polygon_mode[0]));
+}
+
+void
+edan35::OcclusionCuller::update_locations(GLuint program) const
+{
+    auto const link_id = utils::opengl::shader::get_link_id(program);
+    if (program == _locations.program && link_id == _locations.link_id)
+        return;
+
+    _locations.program = program;
+    _locations.link_id = link_id;
+    _locations.vertex_world_to_clip = glGetUniformLocation(program, "vertex_world_to_clip");
+    _locations.box_min = glGetUniformLocation(program, "box_min");
+    _locations.box_max = glGetUniformLocation(program, "box_max");
+}
+
+void
+edan35::OcclusionCuller::reset(chunk& c)
+{
+    // A result still in flight belongs to the previous content of the
+    // slot: it is never read, and the next query overwrites it.
+    c.occlusion_pending = false;
+    c.occluded = false;
+}
+
+void
+edan35::OcclusionCuller::release(chunk& c)
+{
+    glDeleteQueries(1, &c.occlusion_query);
+    c.occlusion_query = 0u;
+    reset(c);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "chunk_manager.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Skips chunks hidden behind the terrain drawn in front of
+    //!        them, using hardware occlusion queries.
+    //!
+    //! Results are read one frame late, once available, so the CPU never
+    //! waits for the GPU. Once every visible chunk has been drawn, both
+    //! the occluded chunks and the drawn ones, which are batched together
+    //! rather than drawn one at a time, are queried by drawing their
+    //! bounding box against the depth buffer. A chunk therefore reappears
+    //! at most a frame after it is uncovered.
+    class OcclusionCuller {
+    public:
+        //! \brief Create an occlusion culler.
+        //!
+        //! @param [in] near_distance distance from the camera to its near
+        //!             plane; boxes closer than that are never queried
+        OcclusionCuller(float near_distance);
+
+        //! \brief Release the vertex array used to draw bounding boxes.
+        ~OcclusionCuller();
+
+        OcclusionCuller(OcclusionCuller const&) = delete;
+        OcclusionCuller& operator=(OcclusionCuller const&) = delete;
+
+        //! \brief Return whether the latest query of a chunk found it
+        //!        fully hidden.
+        //!
+        //! Chunks containing the camera, or almost, are always visible, as
+        //! their box would be clipped by the near plane.
+        //!
+        //! @param [in,out] c the chunk, whose query result gets updated if
+        //!                 it became available
+        //! @param [in] chunks the manager owning the chunk
+        //! @param [in] camera_position world-space position of the camera
+        bool is_occluded(chunk& c, ChunkManager const& chunks, glm::vec3 const& camera_position) const;
+
+        //! \brief Query chunks skipped for being occluded, or drawn
+        //!        together without a query of their own, by drawing their
+        //!        bounding boxes without writing colour nor depth.
+        //!
+        //! Chunks whose previous query is still in flight are skipped.
+        //!
+        //! @param [in] program program made of `bounding_box.vert` and
+        //!             `bounding_box.frag`
+        //! @param [in] world_to_clip transform of the current camera
+        //! @param [in] chunks the manager owning the chunks
+        //! @param [in] occluded chunks to query
+        void test(GLuint program, glm::mat4 const& world_to_clip, ChunkManager const& chunks,
+                  std::vector<chunk*> const& occluded) const;
+
+        //! \brief Forget the occlusion state of a chunk, e.g. once its pool
+        //!        slot is reused for another chunk.
+        static void reset(chunk& c);
+
+        //! \brief Release the query object of a chunk.
+        static void release(chunk& c);
+
+    private:
+        // Uniform locations in the program last tested with, looked up
+        // again when it changes or gets relinked.
+        struct uniform_locations {
+            GLuint program;
+            size_t link_id;
+            GLint vertex_world_to_clip;
+            GLint box_min;
+            GLint box_max;
+        };
+
+        void update_locations(GLuint program) const;
+
+        float _near_distance;
+        GLuint _box_vao;
+        mutable uniform_locations _locations;
+    };
+}
+
@@ -0,0 +1,122 @@
+#include "pass_timers.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+
+constexpr size_t edan35::PassTimers::frames_in_flight;
+
+// Nearest-rank percentile of sorted samples.
+static double
+percentile(std::vector<double> const& sorted, double p)
+{
+    auto const rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::min(std::max<size_t>(rank, 1u), sorted.size()) - 1u];
+}
+
+edan35::PassTimers::PassTimers(std::vector<std::string> const& names, size_t history_size)
+    : _names(names), _history_size(history_size), _histories(names.size()), _frames(), _frame(0u), _dropped_frames_nb(0u)
+{
+    assert(history_size > 0u);
+
+    for (auto& history : _histories) {
+        history.samples.reserve(history_size);
+        history.next = 0u;
+    }
+    for (auto& frame : _frames) {
+        frame.queries.resize(2u * names.size(), 0u);
+        glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        for (auto const query : frame.queries)
+            assert(query != 0u);
+        frame.ended.assign(names.size(), false);
+        frame.used = false;
+    }
+}
+
+edan35::PassTimers::~PassTimers()
+{
+    for (auto& frame : _frames) {
+        glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame.queries.clear();
+    }
+}
+
+void
+edan35::PassTimers::begin_frame()
+{
+    ++_frame;
+    auto& frame = _frames[_frame % frames_in_flight];
+    if (frame.used)
+        collect(frame);
+    frame.ended.assign(_names.size(), false);
+    frame.used = true;
+}
+
+void
+edan35::PassTimers::begin(size_t pass)
+{
+    assert(pass < _names.size());
+    glQueryCounter(_frames[_frame % frames_in_flight].queries[2u * pass], GL_TIMESTAMP);
+}
+
+void
+edan35::PassTimers::end(size_t pass)
+{
+    assert(pass < _names.size());
+    auto& frame = _frames[_frame % frames_in_flight];
+    glQueryCounter(frame.queries[2u * pass + 1u], GL_TIMESTAMP);
+    frame.ended[pass] = true;
+}
+
+edan35::PassTimers::statistics
+edan35::PassTimers::get_statistics(size_t pass) const
+{
+    statistics stats = { 0.0, 0.0, 0.0, 0.0, 0.0, 0u };
+    auto sorted = _histories[pass].samples;
+    if (sorted.empty())
+        return stats;
+
+    std::sort(sorted.begin(), sorted.end());
+    for (auto const sample : sorted)
+        stats.average += sample;
+    stats.average /= static_cast<double>(sorted.size());
+    stats.median = percentile(sorted, 0.5);
+    stats.p95 = percentile(sorted, 0.95);
+    stats.p99 = percentile(sorted, 0.99);
+    stats.max = sorted.back();
+    stats.samples_nb = sorted.size();
+    return stats;
+}
+
+void
+edan35::PassTimers::collect(frame_queries& frame)
+{
+    // Passes may be recorded in any order: all of them must be done.
+    for (size_t pass = 0u; pass < frame.ended.size(); ++pass) {
+        if (!frame.ended[pass])
+            continue;
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(frame.queries[2u * pass + 1u], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available != GL_TRUE) {
+            ++_dropped_frames_nb;
+            return;
+        }
+    }
+
+    for (size_t pass = 0u; pass < frame.ended.size(); ++pass) {
+        if (!frame.ended[pass])
+            continue;
+        GLuint64 start = 0u, end = 0u;
+        glGetQueryObjectui64v(frame.queries[2u * pass], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[2u * pass + 1u], GL_QUERY_RESULT, &end);
+        auto const milliseconds = static_cast<double>(end - start) * 0.000001;
+
+        auto& history = _histories[pass];
+        if (history.samples.size() < _history_size)
+            history.samples.push_back(milliseconds);
+        else
+            history.samples[history.next] = milliseconds;
+        history.next = (history.next + 1u) % _history_size;
+    }
+}
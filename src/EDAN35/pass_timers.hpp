@@ -0,0 +1,93 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Measures how long the GPU spends on each of a fixed set of
+    //!        render passes, and keeps statistics over the latest frames.
+    //!
+    //! Every pass is bracketed by two `GL_TIMESTAMP` queries. Queries go in
+    //! a ring of a few frames, and their results are only read when their
+    //! slot comes around again, if available: the CPU never waits for the
+    //! GPU, and frames whose results are late are left out of the
+    //! statistics instead.
+    class PassTimers {
+    public:
+        //! \brief Statistics over the latest frames, in milliseconds.
+        struct statistics {
+            double average;
+            double median;
+            double p95;
+            double p99;
+            double max;
+            size_t samples_nb;
+        };
+
+        //! \brief Create timers.
+        //!
+        //! @param [in] names name of every pass, in the order of their
+        //!             indices
+        //! @param [in] history_size number of frames the statistics are
+        //!             computed over
+        PassTimers(std::vector<std::string> const& names, size_t history_size);
+
+        //! \brief Release the queries.
+        ~PassTimers();
+
+        PassTimers(PassTimers const&) = delete;
+        PassTimers& operator=(PassTimers const&) = delete;
+
+        //! \brief Move on to a new frame, collecting the results of the
+        //!        frame which last used the same queries.
+        void begin_frame();
+
+        //! \brief Record the GPU time at which a pass starts.
+        void begin(size_t pass);
+
+        //! \brief Record the GPU time at which a pass ends.
+        void end(size_t pass);
+
+        //! \brief Return the number of passes.
+        size_t get_passes_nb() const { return _names.size(); }
+
+        //! \brief Return the name of a pass.
+        std::string const& get_name(size_t pass) const { return _names[pass]; }
+
+        //! \brief Compute the statistics of a pass over the latest frames.
+        statistics get_statistics(size_t pass) const;
+
+        //! \brief Return the number of frames left out of the statistics
+        //!        because their results were not available in time.
+        size_t get_dropped_frames_nb() const { return _dropped_frames_nb; }
+
+    private:
+        static constexpr size_t frames_in_flight = 4u;
+
+        struct frame_queries {
+            std::vector<GLuint> queries; // start and end of every pass
+            std::vector<bool>   ended;   // whether both queries of a pass were issued
+            bool                used;
+        };
+
+        struct pass_history {
+            std::vector<double> samples; // ring, in milliseconds
+            size_t              next;
+        };
+
+        void collect(frame_queries& frame);
+
+        std::vector<std::string> _names;
+        size_t _history_size;
+        std::vector<pass_history> _histories;
+        std::array<frame_queries, frames_in_flight> _frames;
+        size_t _frame;
+        size_t _dropped_frames_nb;
+    };
+}
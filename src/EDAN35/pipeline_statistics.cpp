@@ -0,0 +1,119 @@
+#include "pipeline_statistics.hpp"
+
+#include "core/Log.h"
+
+#include <cassert>
+
+
+constexpr size_t edan35::PipelineStatistics::frames_in_flight;
+constexpr size_t edan35::PipelineStatistics::targets_nb;
+
+// In the order of the queries; only the first one is a query target in
+// core OpenGL 4.1.
+static GLenum const targets[] = {
+    GL_PRIMITIVES_GENERATED,
+    GL_GEOMETRY_SHADER_INVOCATIONS,
+    GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED_ARB,
+    GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+};
+
+static GLint64 edan35::pipeline_counters::* const fields[] = {
+    &edan35::pipeline_counters::primitives_generated,
+    &edan35::pipeline_counters::gs_invocations,
+    &edan35::pipeline_counters::gs_primitives,
+    &edan35::pipeline_counters::clipping_input,
+    &edan35::pipeline_counters::clipping_output,
+    &edan35::pipeline_counters::fragment_invocations
+};
+
+edan35::PipelineStatistics::PipelineStatistics()
+    : _is_detailed(GLAD_GL_ARB_pipeline_statistics_query != 0), _targets_nb(0u), _frames(), _frame(0u), _collected()
+{
+    static_assert(sizeof(targets) / sizeof(targets[0]) == targets_nb, "one target per counter");
+    static_assert(sizeof(fields) / sizeof(fields[0]) == targets_nb, "one field per counter");
+
+    _targets_nb = _is_detailed ? targets_nb : 1u;
+    if (!_is_detailed)
+        LogInfo("GL_ARB_pipeline_statistics_query is not supported: only generated primitives will be counted");
+
+    for (auto& f : _frames) {
+        f.queries.fill(0u);
+        glGenQueries(static_cast<GLsizei>(_targets_nb), f.queries.data());
+        for (size_t i = 0u; i < _targets_nb; ++i)
+            assert(f.queries[i] != 0u);
+        f.frame = 0u;
+        f.pending = false;
+    }
+}
+
+edan35::PipelineStatistics::~PipelineStatistics()
+{
+    for (auto& f : _frames) {
+        glDeleteQueries(static_cast<GLsizei>(_targets_nb), f.queries.data());
+        f.queries.fill(0u);
+    }
+}
+
+void
+edan35::PipelineStatistics::begin()
+{
+    auto& f = _frames[_frame % frames_in_flight];
+    // Only happens when the GPU is more than frames_in_flight frames
+    // behind; the results are kept for the next call to collect().
+    if (f.pending)
+        read(f);
+
+    for (size_t i = 0u; i < _targets_nb; ++i)
+        glBeginQuery(targets[i], f.queries[i]);
+}
+
+void
+edan35::PipelineStatistics::end()
+{
+    auto& f = _frames[_frame % frames_in_flight];
+    for (size_t i = 0u; i < _targets_nb; ++i)
+        glEndQuery(targets[i]);
+    f.frame = _frame;
+    f.pending = true;
+    ++_frame;
+}
+
+std::vector<edan35::pipeline_counters>
+edan35::PipelineStatistics::collect(bool wait)
+{
+    // The slot of the next frame holds the oldest results.
+    for (size_t i = 0u; i < frames_in_flight; ++i) {
+        auto& f = _frames[(_frame + i) % frames_in_flight];
+        if (!f.pending)
+            continue;
+        if (!wait) {
+            GLuint available = GL_TRUE;
+            for (size_t j = 0u; j < _targets_nb && available == GL_TRUE; ++j)
+                glGetQueryObjectuiv(f.queries[j], GL_QUERY_RESULT_AVAILABLE, &available);
+            // Keep the results in order: newer frames are not done either.
+            if (available != GL_TRUE)
+                break;
+        }
+        read(f);
+    }
+
+    std::vector<pipeline_counters> collected;
+    collected.swap(_collected);
+    return collected;
+}
+
+void
+edan35::PipelineStatistics::read(frame_queries& f)
+{
+    pipeline_counters counters;
+    counters.frame = f.frame;
+    for (size_t i = 0u; i < _targets_nb; ++i) {
+        GLuint64 value = 0u;
+        glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &value);
+        counters.*fields[i] = static_cast<GLint64>(value);
+    }
+    _collected.push_back(counters);
+    f.pending = false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Counts of the work done by the GPU between
+    //!        `PipelineStatistics::begin()` and `end()`.
+    //!
+    //! Counters the driver cannot provide are negative.
+    struct pipeline_counters {
+        size_t  frame;                //!< index of the frame, counting calls to `begin()`
+        GLint64 primitives_generated; //!< primitives output by the last vertex processing stage
+        GLint64 gs_invocations;       //!< geometry shader invocations
+        GLint64 gs_primitives;        //!< primitives emitted by geometry shaders
+        GLint64 clipping_input;       //!< primitives entering the clipping stage
+        GLint64 clipping_output;      //!< primitives left after clipping
+        GLint64 fragment_invocations; //!< fragment shader invocations
+
+        pipeline_counters() : frame(0u), primitives_generated(-1), gs_invocations(-1), gs_primitives(-1),
+                              clipping_input(-1), clipping_output(-1), fragment_invocations(-1)
+        {
+        }
+    };
+
+    //! \brief Counts shader invocations and primitives, once per frame.
+    //!
+    //! Uses `GL_ARB_pipeline_statistics_query` when the driver exposes it;
+    //! otherwise, only `GL_PRIMITIVES_GENERATED` is counted. Results are
+    //! collected a few frames late, like those of `PassTimers`, so the CPU
+    //! only waits for the GPU when it is more than that many frames behind.
+    //!
+    //! `GL_PRIMITIVES_GENERATED` must not be queried by anything else
+    //! between `begin()` and `end()`, which rules out generating chunks with
+    //! the GPU mesher in between.
+    class PipelineStatistics {
+    public:
+        //! \brief Create the queries, depending on what the driver exposes.
+        PipelineStatistics();
+
+        //! \brief Release the queries.
+        ~PipelineStatistics();
+
+        PipelineStatistics(PipelineStatistics const&) = delete;
+        PipelineStatistics& operator=(PipelineStatistics const&) = delete;
+
+        //! \brief Return whether all counters are available, rather than
+        //!        only the generated primitives.
+        bool is_detailed() const { return _is_detailed; }
+
+        //! \brief Start counting for a new frame.
+        void begin();
+
+        //! \brief Stop counting for the current frame.
+        void end();
+
+        //! \brief Return the counters of the frames whose results became
+        //!        available since the previous call, oldest first.
+        //!
+        //! @param [in] wait whether to wait for the results of all frames
+        std::vector<pipeline_counters> collect(bool wait);
+
+    private:
+        static constexpr size_t frames_in_flight = 4u;
+        static constexpr size_t targets_nb = 6u;
+
+        struct frame_queries {
+            std::array<GLuint, targets_nb> queries;
+            size_t frame;
+            bool   pending;
+        };
+
+        void read(frame_queries& f);
+
+        bool _is_detailed;
+        size_t _targets_nb;
+        std::array<frame_queries, frames_in_flight> _frames;
+        size_t _frame;
+        std::vector<pipeline_counters> _collected;
+    };
+}
@@ -0,0 +1,190 @@
+#include "streaming_buffer.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace constant
+{
+    // GL_MIN_MAP_BUFFER_ALIGNMENT is at least 64 wherever it is defined.
+    constexpr size_t write_alignment = 64u;
+
+    // How long to wait for a fence before checking again, in nanoseconds.
+    constexpr GLuint64 fence_timeout = 1000000000u;
+}
+
+static bool
+overlaps(std::pair<size_t, size_t> const& a, std::pair<size_t, size_t> const& b)
+{
+    return a.first < b.second && b.first < a.second;
+}
+
+edan35::StreamingBuffer::StreamingBuffer(size_t capacity)
+    : _capacity(capacity), _bo(0u), _mapping(nullptr), _head(0u), _write(0u, 0u), _unfenced(), _fenced(), _stalls_nb(0u)
+{
+    assert(capacity > 0u);
+    allocate();
+    if (is_persistent())
+        LogInfo("Streaming uploads through a persistently mapped buffer of %u bytes", static_cast<unsigned int>(_capacity));
+    else
+        LogInfo("Streaming uploads through an orphaned buffer of %u bytes", static_cast<unsigned int>(_capacity));
+}
+
+edan35::StreamingBuffer::~StreamingBuffer()
+{
+    for (auto& f : _fenced)
+        glDeleteSync(f.fence);
+    _fenced.clear();
+
+    if (_mapping != nullptr) {
+        glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+        _mapping = nullptr;
+    }
+    glDeleteBuffers(1, &_bo);
+    _bo = 0u;
+}
+
+void*
+edan35::StreamingBuffer::begin_write(size_t size)
+{
+    if (size == 0u || size > _capacity)
+        return nullptr;
+
+    if (_head + size > _capacity) {
+        _head = 0u;
+        if (!is_persistent()) {
+            // Orphan the storage instead of waiting for the GPU to be done
+            // with it.
+            glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+            glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(_capacity), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+        }
+    }
+    _write = range(_head, _head + size);
+    _head = std::min(_capacity, (_write.second + constant::write_alignment - 1u) / constant::write_alignment * constant::write_alignment);
+
+    if (is_persistent()) {
+        wait_for(_write);
+        return _mapping + _write.first;
+    }
+
+    // Nothing the GPU may still read lies in the range, since the last
+    // orphaning.
+    glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+    auto const data = glMapBufferRange(GL_COPY_READ_BUFFER, static_cast<GLintptr>(_write.first), static_cast<GLsizeiptr>(size),
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+    if (data == nullptr) {
+        LogError("Failed to map %u bytes of the streaming buffer", static_cast<unsigned int>(size));
+        _write = range(0u, 0u);
+    }
+    return data;
+}
+
+bool
+edan35::StreamingBuffer::end_write(GLuint buffer, size_t offset)
+{
+    if (_write.first == _write.second)
+        return false;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+    if (!is_persistent() && glUnmapBuffer(GL_COPY_READ_BUFFER) == GL_FALSE) {
+        // The content of the mapping was lost, e.g. on a mode switch.
+        glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+        LogWarning("Streaming buffer content was lost while mapped");
+        _write = range(0u, 0u);
+        return false;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(_write.first),
+                        static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(_write.second - _write.first));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+
+    if (is_persistent())
+        _unfenced.push_back(_write);
+    _write = range(0u, 0u);
+    return true;
+}
+
+void
+edan35::StreamingBuffer::end_frame()
+{
+    if (!_unfenced.empty())
+        fence();
+}
+
+void
+edan35::StreamingBuffer::allocate()
+{
+    glGenBuffers(1, &_bo);
+    assert(_bo != 0u);
+    glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+
+    if (GLAD_GL_ARB_buffer_storage) {
+        GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(_capacity), nullptr, flags);
+        _mapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(_capacity), flags));
+        if (_mapping == nullptr) {
+            // Immutable storage cannot be reallocated: start over.
+            LogWarning("Failed to persistently map the streaming buffer");
+            glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+            glDeleteBuffers(1, &_bo);
+            glGenBuffers(1, &_bo);
+            assert(_bo != 0u);
+            glBindBuffer(GL_COPY_READ_BUFFER, _bo);
+        }
+    }
+    if (_mapping == nullptr)
+        glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(_capacity), nullptr, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+}
+
+void
+edan35::StreamingBuffer::fence()
+{
+    fenced_ranges f;
+    f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0u);
+    f.ranges.swap(_unfenced);
+    _fenced.push_back(f);
+}
+
+void
+edan35::StreamingBuffer::wait_for(range const& r)
+{
+    // Writes of the current frame wrapped around onto themselves.
+    for (auto const& u : _unfenced) {
+        if (overlaps(u, r)) {
+            fence();
+            break;
+        }
+    }
+
+    // Fences signal in order: waiting for the last overlapping one is
+    // enough, and releases all the older ones.
+    auto last = _fenced.end();
+    for (auto it = _fenced.begin(); it != _fenced.end(); ++it)
+        for (auto const& f : it->ranges)
+            if (overlaps(f, r))
+                last = it;
+    if (last == _fenced.end())
+        return;
+
+    auto status = glClientWaitSync(last->fence, 0u, 0u);
+    if (status == GL_TIMEOUT_EXPIRED)
+        ++_stalls_nb;
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(last->fence, GL_SYNC_FLUSH_COMMANDS_BIT, constant::fence_timeout);
+    if (status == GL_WAIT_FAILED)
+        LogError("Failed to wait for the streaming buffer fence");
+
+    ++last;
+    for (auto it = _fenced.begin(); it != last; ++it)
+        glDeleteSync(it->fence);
+    _fenced.erase(_fenced.begin(), last);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+
+namespace edan35
+{
+    //! \brief Ring of staging memory through which data is streamed to
+    //!        other buffers, without the driver copies and stalls of
+    //!        `glBufferSubData()`.
+    //!
+    //! Data is written straight into mapped memory, then copied on the GPU
+    //! into its destination with `glCopyBufferSubData()`.
+    //!
+    //! With `GL_ARB_buffer_storage`, the ring is mapped once, persistently,
+    //! and every frame's writes are guarded by a fence; the CPU only waits
+    //! when it is about to overwrite memory the GPU has yet to copy from.
+    //! Otherwise, ranges are mapped unsynchronised one at a time, and the
+    //! buffer is orphaned whenever the ring wraps around.
+    class StreamingBuffer {
+    public:
+        //! \brief Create the staging buffer.
+        //!
+        //! @param [in] capacity size in bytes of the ring
+        StreamingBuffer(size_t capacity);
+
+        //! \brief Release the staging buffer and its fences.
+        ~StreamingBuffer();
+
+        StreamingBuffer(StreamingBuffer const&) = delete;
+        StreamingBuffer& operator=(StreamingBuffer const&) = delete;
+
+        //! \brief Return whether the ring is persistently mapped.
+        bool is_persistent() const { return _mapping != nullptr; }
+
+        //! \brief Reserve room in the ring and return where to write to.
+        //!
+        //! Must be followed by a call to `end_write()` before any other
+        //! write is started.
+        //!
+        //! @param [in] size number of bytes to write
+        //! @return where to write the bytes, or `nullptr` if they do not
+        //!         fit in the ring or the mapping failed
+        void* begin_write(size_t size);
+
+        //! \brief Copy the bytes of the last write into a buffer.
+        //!
+        //! @param [in] buffer the buffer receiving the bytes
+        //! @param [in] offset where to copy the bytes in `buffer`
+        //! @return whether the bytes could be copied
+        bool end_write(GLuint buffer, size_t offset);
+
+        //! \brief Guard the writes of the current frame with a fence.
+        void end_frame();
+
+        //! \brief Return the number of times the CPU had to wait for the
+        //!        GPU before writing.
+        size_t get_stalls_nb() const { return _stalls_nb; }
+
+    private:
+        using range = std::pair<size_t, size_t>; // first and past-the-last bytes
+
+        struct fenced_ranges {
+            GLsync             fence;
+            std::vector<range> ranges;
+        };
+
+        void allocate();
+        void fence();
+        void wait_for(range const& r);
+
+        size_t _capacity;
+        GLuint _bo;
+        unsigned char* _mapping;
+        size_t _head;
+        range _write;
+        std::vector<range> _unfenced;
+        std::deque<fenced_ranges> _fenced;
+        size_t _stalls_nb;
+    };
+}
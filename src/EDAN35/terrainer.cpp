@@ -1,7 +1,22 @@
 #include "terrainer.hpp"
+#include "benchmark.hpp"
+#include "chunk_manager.hpp"
+#include "cpu_mesher.hpp"
+#include "density.hpp"
+#include "density_pass.hpp"
+#include "density_tiles.hpp"
+#include "draw_list.hpp"
+#include "frame_uniforms.hpp"
+#include "frustum.hpp"
+#include "gpu_mesher.hpp"
 #include "helpers.hpp"
+#include "mesh_pool.hpp"
 #include "node.hpp"
+#include "occlusion_culler.hpp"
+#include "pass_timers.hpp"
+#include "pipeline_statistics.hpp"
 #include "parametric_shapes.hpp"
+#include "streaming_buffer.hpp"
 #include "marching_tables.hpp"
 
 #include "config.hpp"
@@ -14,6 +29,9 @@
 #include "core/Log.h"
 #include "core/LogView.h"
 #include "core/Misc.h"
+#include "core/opengl.hpp"
+#include "core/Profiler.h"
+#include "core/ProfilerView.h"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
@@ -30,8 +48,13 @@
 
 #include <vector>
 #include <array>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 
 enum class polygon_mode_t : unsigned int {
@@ -45,6 +68,22 @@ static polygon_mode_t get_next_mode(polygon_mode_t mode)
     return static_cast<polygon_mode_t>((static_cast<unsigned int>(mode) + 1u) % 3u);
 }
 
+//! \brief How the marching-cubes triangles of the terrain are produced.
+enum class mesher_t : int {
+    geometry_shader = 0,    //!< run the geometry shader on every frame
+    transform_feedback,     //!< run it once per chunk and draw the cached triangles
+    cpu                     //!< extract chunks on worker threads and draw the uploaded triangles
+};
+
+//! \brief Parts of a frame whose GPU time is measured, see PassTimers.
+enum class pass_t : size_t {
+    generation = 0u,    //!< evaluating, meshing and uploading chunks
+    terrain,            //!< drawing and occlusion-testing chunks
+    overlay,            //!< drawing the ImGui windows
+    swap,               //!< presenting the frame
+    count
+};
+
 namespace constant
 {
     constexpr uint32_t shadowmap_res_x = 1024;
@@ -54,16 +93,81 @@ namespace constant
     constexpr float  light_intensity     = 720000.0f;
     constexpr float  light_angle_falloff = 0.8f;
     constexpr float  light_cutoff        = 0.05f;
+
+    constexpr float        chunk_size                  = 10.0f;
+    constexpr unsigned int chunk_cells_nb              = 32u;
+    constexpr int          chunk_view_radius           = 5;
+    constexpr size_t       chunk_pool_size             = 600;
+    constexpr size_t       chunk_generations_per_frame = 8;
+    constexpr int          chunk_lod_levels_nb         = 4;    // 32, 16, 8 and 4 cells per edge
+    constexpr float        chunk_lod_radii[]           = { 1.5f, 2.5f, 3.5f }; // in chunks
+
+    // Shared by `density.frag` and the CPU mesher, which compute the
+    // same noise from it.
+    constexpr uint32_t noise_seed = 0x2545f491u;
+
+    // Chunks whose density is baked into tiles, around the starting point
+    // of the camera: the terrain never changes there, short of reloading
+    // the density graph.
+    constexpr int    tile_region_radius   = 3;  // in chunks, along x and z
+    constexpr int    tile_region_min_y    = -1; // in chunks
+    constexpr int    tile_region_max_y    = 0;  // in chunks
+    constexpr size_t tile_bake_threads_nb = 2;  // leaving the other threads to the CPU mesher
+    // Densities change by at most about 0.7 across the finest cells around
+    // the surface: tiles keep four cells' worth of it.
+    constexpr float  tile_density_band    = 4.0f;
+
+    constexpr size_t pass_history_size = 240; // frames
+
+    // Room for a few frames' worth of CPU meshes.
+    constexpr size_t streaming_buffer_size = 16u * 1024u * 1024u; // bytes
+
+    // Initial size of the pool of CPU meshes, which grows as needed.
+    constexpr size_t mesh_pool_vertices_nb = 1024u * 1024u;
+    constexpr size_t mesh_pool_indices_nb  = 3u * mesh_pool_vertices_nb;
+}
+
+// Locations of the per-chunk uniforms in one of the chunk programs.
+struct chunk_uniform_locations {
+    size_t link_id;
+    GLint  cube_step;
+    GLint  face_ratios;
+};
+
+// Set the uniforms of a chunk, looking their locations up again only once
+// the program got relinked.
+static void set_chunk_uniforms(GLuint program, edan35::chunk_lod const& lod,
+                               std::unordered_map<GLuint, chunk_uniform_locations>& locations_by_program)
+{
+    auto const link_id = utils::opengl::shader::get_link_id(program);
+    auto const inserted = locations_by_program.emplace(program, chunk_uniform_locations{ 0u, -1, -1 });
+    auto& locations = inserted.first->second;
+    if (inserted.second || locations.link_id != link_id) {
+        locations.link_id = link_id;
+        locations.cube_step = glGetUniformLocation(program, "cube_step");
+        locations.face_ratios = glGetUniformLocation(program, "face_ratios");
+    }
+
+    // The size of the cells depends on the level of detail of the chunk.
+    GLint face_ratios[6];
+    for (size_t face = 0u; face < 6u; ++face)
+        face_ratios[face] = lod.get_face_ratio(face);
+    glUniform1f(locations.cube_step, 2.0f / static_cast<float>(constant::chunk_cells_nb >> lod.level));
+    glUniform1iv(locations.face_ratios, 6, face_ratios);
 }
 
 static eda221::mesh_data loadCone();
 
-edan35::Terrainer::Terrainer()
+edan35::Terrainer::Terrainer(benchmark_settings const& bench) : bench_settings(bench)
 {
     Log::View::Init();
 
+    // Benchmarks should not be limited by the refresh rate of a display
+    // they do not need.
     window = Window::Create("Terrainer", config::resolution_x,
-                            config::resolution_y, config::msaa_rate, false, false);
+                            config::resolution_y, config::msaa_rate, false, false,
+                            bench.enabled ? Window::DISABLE_VSYNC : Window::ENABLE_VSYNC,
+                            !bench.enabled);
     if (window == nullptr) {
         Log::View::Destroy();
         throw std::runtime_error("Failed to get a window: aborting!");
@@ -74,6 +178,9 @@ edan35::Terrainer::Terrainer()
     GLStateInspection::Init();
     GLStateInspection::View::Init();
 
+    Profiler::Init();
+    Profiler::View::Init();
+
     eda221::init();
 }
 
@@ -81,6 +188,9 @@ edan35::Terrainer::~Terrainer()
 {
     eda221::deinit();
 
+    Profiler::View::Destroy();
+    Profiler::Destroy();
+
     GLStateInspection::View::Destroy();
     GLStateInspection::Destroy();
 
@@ -109,12 +219,15 @@ edan35::Terrainer::run()
     mCamera.mMovementSpeed = 0.05f;
     window->SetCamera(&mCamera);
 
-    auto const cube = parametric_shapes::create_cube(32u);
-    if (cube.vao == 0u) {
-        LogError("Failed to load marching cube");
-        return;
+    // One point grid per level of detail, each point standing for a cell.
+    std::vector<eda221::mesh_data> point_grids;
+    for (int level = 0; level < constant::chunk_lod_levels_nb; ++level) {
+        point_grids.push_back(parametric_shapes::create_cube(constant::chunk_cells_nb >> level));
+        if (point_grids.back().vao == 0u) {
+            LogError("Failed to load marching cube");
+            return;
+        }
     }
-    float const cube_step = static_cast<float>(2.0 / 32.0);
     //
     // Load all the shader programs used
     //
@@ -137,24 +250,89 @@ edan35::Terrainer::run()
         }
     };
 
+    // Recompiled along with the shaders, so that the terrain can be tuned
+    // without restarting; a graph failing to compile keeps the previous
+    // one.
+    auto density_graph = std::make_shared<density_program const>();
+    GLuint density_shader = 0u;
     GLuint marching_shader = 0u;
-    auto const reload_shaders = [&reload_shader, &marching_shader]() {
+    GLuint classify_shader = 0u;
+    GLuint extract_shader = 0u;
+    GLuint terrain_shader = 0u;
+    GLuint pooled_terrain_shader = 0u;
+    GLuint bounding_box_shader = 0u;
+    auto const reload_shaders = [&reload_shader, &density_graph, &density_shader, &marching_shader, &classify_shader, &extract_shader, &terrain_shader, &pooled_terrain_shader, &bounding_box_shader, fallback_shader]() {
         LogInfo("Reloading shaders");
+        auto graph = std::make_shared<density_program>();
+        if (compile_density_graph(config::shaders_path("TERRAINER/density.graph"), *graph))
+            density_graph = graph;
+        if (density_shader != 0u)
+            glDeleteProgram(density_shader);
+        density_shader = DensityPass::create_program(*density_graph);
+        if (density_shader == 0u) {
+            LogError("Failed to load \"density.vert\", \"density.frag\" and \"density.graph\"");
+        } else {
+            glUseProgram(density_shader);
+            glUniform1ui(glGetUniformLocation(density_shader, "noise_seed"), constant::noise_seed);
+            glUseProgram(0u);
+        }
+
         reload_shader("marching.vert", "marching.geo", "marching.frag", marching_shader);
+
+        if (classify_shader != 0u)
+            glDeleteProgram(classify_shader);
+        classify_shader = eda221::createTransformFeedbackProgram("TERRAINER/", "marching.vert", "classify.geo", { "cell_position" });
+        if (classify_shader == 0u)
+            LogError("Failed to load \"marching.vert\" and \"classify.geo\"");
+
+        if (extract_shader != 0u)
+            glDeleteProgram(extract_shader);
+        extract_shader = eda221::createTransformFeedbackProgram("TERRAINER/", "marching.vert", "marching.geo", { "vertex", "normal" });
+        if (extract_shader == 0u)
+            LogError("Failed to load \"marching.vert\" and \"marching.geo\" for extraction");
+
+        if (terrain_shader != 0u && terrain_shader != fallback_shader)
+            glDeleteProgram(terrain_shader);
+        terrain_shader = eda221::createProgram("TERRAINER/", "terrain.vert", "marching.frag");
+        if (terrain_shader == 0u) {
+            LogError("Failed to load \"terrain.vert\" and \"marching.frag\"");
+            terrain_shader = fallback_shader;
+        }
+
+        // The fallback shader would ignore the placement of the chunks.
+        if (pooled_terrain_shader != 0u)
+            glDeleteProgram(pooled_terrain_shader);
+        pooled_terrain_shader = eda221::createProgram("TERRAINER/", "pooled_terrain.vert", "marching.frag");
+        if (pooled_terrain_shader == 0u)
+            LogError("Failed to load \"pooled_terrain.vert\" and \"marching.frag\"");
+
+        if (bounding_box_shader != 0u)
+            glDeleteProgram(bounding_box_shader);
+        bounding_box_shader = eda221::createProgram("TERRAINER/", "bounding_box.vert", "bounding_box.frag");
+        if (bounding_box_shader == 0u)
+            LogError("Failed to load \"bounding_box.vert\" and \"bounding_box.frag\"");
+
+        for (auto const program : { marching_shader, terrain_shader, pooled_terrain_shader })
+            FrameUniforms::bind_block(program);
     };
     reload_shaders();
 
-    auto const light_position = glm::vec3(10.0f, 10.0f, 15.0f);
-    auto const light_ambient = glm::vec4(0.3f, 0.3f, 0.3f, 1.0f);
-    auto const light_diffuse = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
-    auto const light_specular = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
-    auto const set_uniforms = [&light_position, &light_ambient, &light_diffuse, &light_specular, &cube_step, &mCamera](GLuint program){
-        glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-        glUniform4fv(glGetUniformLocation(program, "light_ambient"), 1, glm::value_ptr(light_ambient));
-        glUniform4fv(glGetUniformLocation(program, "light_diffuse"), 1, glm::value_ptr(light_diffuse));
-        glUniform4fv(glGetUniformLocation(program, "light_specular"), 1, glm::value_ptr(light_specular));
-        glUniform4fv(glGetUniformLocation(program, "camera_pos"), 1, glm::value_ptr(mCamera.mWorld.GetTranslation()));
-    	glUniform1f(glGetUniformLocation(program, "cube_step"), cube_step);
+    // Camera and lights go through a uniform buffer shared by all
+    // programs, updated once per frame.
+    FrameUniforms frame_uniforms;
+    frame_data frame;
+    frame.light_position = glm::vec4(10.0f, 10.0f, 15.0f, 1.0f);
+    frame.light_ambient = glm::vec4(0.3f, 0.3f, 0.3f, 1.0f);
+
+    // Both captures are pointers, small enough for the std::function kept
+    // by DrawList to store them without allocating.
+    std::unordered_map<GLuint, chunk_uniform_locations> chunk_locations;
+    auto const get_chunk_uniforms = [&chunk_locations](chunk const& c) {
+        auto const locations = &chunk_locations;
+        auto const lod = &c.lod;
+        return [locations, lod](GLuint program) {
+            set_chunk_uniforms(program, *lod, *locations);
+        };
     };
 
     int* edge_conn = create_edge_conn();
@@ -168,35 +346,161 @@ edan35::Terrainer::run()
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexImage1D(GL_TEXTURE_1D, 0, GL_R32I, 256*20, 0, GL_RED_INTEGER, GL_INT, edge_conn);
     glBindTexture(GL_TEXTURE_1D, 0u);
-    auto cube_node = Node();
-    cube_node.set_geometry(cube);
-    cube_node.set_program(marching_shader, set_uniforms);
-    cube_node.scale(glm::vec3(5.0f, 5.0f, 5.0f));
-    cube_node.add_texture("edge_tex", edge_tex, GL_TEXTURE_1D);
     auto noise_tex = eda221::loadTexture2D("noise.png");
-    cube_node.add_texture("noise_tex", noise_tex, GL_TEXTURE_2D);
-
     auto marble = eda221::loadTexture2D("TexturesCom_ConcreteFloors0060_1_XL.png");
-    cube_node.add_texture("marble_tex", marble);
 
-    float noise[32][32][32];
-    for (int y = 0; y < 32; y++)
-    for (int x = 0; x < 32; x++)
-    for (int z = 0; z < 32; z++) {
-        noise[z][y][x] = (rand() % 32768) / 32768.0;
-    }
+    // Sampled by the filtered noise, which the CPU mesher computes from
+    // the same seed rather than from the texels.
+    auto const noise_texels = make_noise_texels(constant::noise_seed);
     GLuint noise_t = 0u;
     glGenTextures(1, &noise_t);
     assert(noise_t != 0u);
     glBindTexture(GL_TEXTURE_3D, noise_t);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, 32, 32, 32, 0, GL_RED, GL_FLOAT, noise);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, noise_period, noise_period, noise_period, 0, GL_RGBA, GL_UNSIGNED_BYTE, noise_texels.data());
     glBindTexture(GL_TEXTURE_3D, 0u);
-    cube_node.add_texture("noise_t", noise_t, GL_TEXTURE_3D);
+
+    //
+    // Setup the chunks: every chunk draws the same point grid, scaled
+    // and translated to cover its own part of the world.
+    //
+    ChunkManager chunks(constant::chunk_size, constant::chunk_view_radius,
+                        constant::chunk_pool_size, constant::chunk_generations_per_frame);
+    chunks.set_lod_radii(std::vector<float>(std::begin(constant::chunk_lod_radii), std::end(constant::chunk_lod_radii)));
+    for (auto& c : chunks.get_chunks()) {
+        c.node.set_scaling(glm::vec3(0.5f * constant::chunk_size));
+        c.node.add_texture("edge_tex", edge_tex, GL_TEXTURE_1D);
+        c.node.add_texture("noise_tex", noise_tex, GL_TEXTURE_2D);
+        c.node.add_texture("marble_tex", marble);
+    }
+
+    // Both GPU meshers polygonise a lattice of densities evaluated
+    // beforehand, rather than sampling the density in every cell.
+    DensityPass density_pass(constant::chunk_cells_nb);
+    density_pass.add_texture("noise_t", noise_t, GL_TEXTURE_3D);
+
+    GPUMesher gpu_mesher(point_grids);
+    gpu_mesher.add_texture("edge_tex", edge_tex, GL_TEXTURE_1D);
+
+    // Baked in the background; chunks are evaluated until their tile is
+    // done, and are not regenerated when it is, as both give the same
+    // terrain up to the precision of the tiles.
+    DensityTiles density_tiles(constant::chunk_size, constant::chunk_cells_nb, constant::chunk_lod_levels_nb,
+                               constant::tile_density_band, constant::tile_bake_threads_nb);
+
+    CPUMesher cpu_mesher(edge_conn, constant::noise_seed, constant::chunk_cells_nb);
+    LogInfo("CPU mesher running on %u threads", static_cast<unsigned int>(cpu_mesher.get_threads_nb()));
+
+    auto noise = bench_settings.noise;
+    auto tiles = bench_settings.tiles;
+    density_pass.set_noise(noise);
+    cpu_mesher.set_noise(noise);
+    cpu_mesher.set_program(density_graph);
+    cpu_mesher.set_tiles(&density_tiles);
+    auto const bake_tiles = [&density_tiles, &density_pass, &density_graph, &noise, &tiles]() {
+        density_pass.clear_tiles();
+        density_tiles.bake(glm::ivec3(-constant::tile_region_radius, constant::tile_region_min_y, -constant::tile_region_radius),
+                           glm::ivec3(constant::tile_region_radius - 1, constant::tile_region_max_y, constant::tile_region_radius - 1),
+                           density_graph, constant::noise_seed, noise, tiles);
+    };
+    bake_tiles();
+    StreamingBuffer mesh_streaming(constant::streaming_buffer_size);
+    MeshPool mesh_pool(constant::mesh_pool_vertices_nb, constant::mesh_pool_indices_nb);
+
+    // Every generation gets a new ticket, so that meshes finishing after
+    // their chunk was regenerated or evicted can be discarded.
+    size_t next_ticket = 0u;
+
+    auto mesher = mesher_t::transform_feedback;
+    chunks.set_generate_callback([&chunks, &mesher, &density_pass, &gpu_mesher, &cpu_mesher, &mesh_pool, &next_ticket, &density_shader, &classify_shader, &extract_shader, &get_chunk_uniforms](chunk& c) {
+        auto const half_size = 0.5f * chunks.get_chunk_size();
+        auto const center = chunks.get_chunk_origin(c.coord) + glm::vec3(half_size);
+        c.node.set_translation(center);
+        c.mesh_ticket = ++next_ticket;
+        // CPU meshes replace the previous one when uploaded, which keeps
+        // being drawn until then; the GPU meshers replace it right away.
+        if (mesher != mesher_t::cpu)
+            mesh_pool.release(c.pooled_mesh);
+
+        auto const set_uniforms = get_chunk_uniforms(c);
+
+        switch (mesher) {
+        case mesher_t::geometry_shader:
+            // Only the cells crossed by the surface are drawn every frame.
+            if (density_pass.evaluate(density_shader, center - glm::vec3(half_size), chunks.get_chunk_size(), c)
+                && gpu_mesher.classify(classify_shader, set_uniforms, c))
+                c.node.set_geometry(c.active_cells);
+            else
+                c.node.set_geometry(eda221::mesh_data());
+            break;
+        case mesher_t::transform_feedback:
+            if (density_pass.evaluate(density_shader, center - glm::vec3(half_size), chunks.get_chunk_size(), c)
+                && gpu_mesher.classify(classify_shader, set_uniforms, c)
+                && gpu_mesher.extract(extract_shader, set_uniforms, c))
+                c.node.set_geometry(c.mesh);
+            else
+                c.node.set_geometry(eda221::mesh_data());
+            break;
+        case mesher_t::cpu:
+            cpu_mesher.request(c.coord, c.mesh_ticket, center, half_size, c.lod);
+            break;
+        }
+    });
+
+    // Updated every frame, before chunks get loaded and drawn.
+    Frustum frustum;
+    chunks.set_visibility_callback([&frustum](glm::vec3 const& min_corner, glm::vec3 const& max_corner) {
+        return frustum.intersects(min_corner, max_corner);
+    });
+    size_t drawn_chunks_nb = 0u;
+
+    // Chunks hidden last frame are only drawn again once their bounding
+    // box is found to be visible.
+    OcclusionCuller occlusion_culler(1.0f);
+    chunks.set_evict_callback([&mesh_pool](chunk& c) {
+        OcclusionCuller::reset(c);
+        mesh_pool.release(c.pooled_mesh);
+    });
+    auto use_occlusion_culling = true;
+    std::vector<chunk*> occluded_chunks;
+    occluded_chunks.reserve(constant::chunk_pool_size);
+    // Chunks drawn all at once, from the mesh pool or the draw list,
+    // cannot have a query of their own: their bounding boxes are queried
+    // instead.
+    std::vector<chunk*> batched_chunks;
+    batched_chunks.reserve(constant::chunk_pool_size);
+    DrawList draw_list;
+
+    std::unique_ptr<Benchmark> benchmark;
+    if (bench_settings.enabled) {
+        LogInfo("Benchmarking %u frames", static_cast<unsigned int>(bench_settings.frames_nb));
+        benchmark = std::unique_ptr<Benchmark>(new Benchmark(bench_settings.frames_nb));
+    }
+
+    PassTimers pass_timers({ "Generation", "Terrain", "Overlay", "Swap" }, constant::pass_history_size);
+    assert(pass_timers.get_passes_nb() == static_cast<size_t>(pass_t::count));
+    auto const begin_pass = [&pass_timers](pass_t pass) {
+        pass_timers.begin(static_cast<size_t>(pass));
+    };
+    auto const end_pass = [&pass_timers](pass_t pass) {
+        pass_timers.end(static_cast<size_t>(pass));
+    };
+
+    // Counted over the drawing of the chunks only, as generating them uses
+    // the same primitive queries.
+    PipelineStatistics pipeline_statistics;
+    pipeline_counters latest_counters;
+    auto const collect_counters = [&pipeline_statistics, &latest_counters, &benchmark](bool wait) {
+        for (auto const& counters : pipeline_statistics.collect(wait)) {
+            latest_counters = counters;
+            if (benchmark)
+                benchmark->set_counters(counters);
+        }
+    };
 
     auto seconds_nb = 0.0f;
 
@@ -222,13 +526,23 @@ edan35::Terrainer::run()
         fpsSamples++;
         seconds_nb += static_cast<float>(ddeltatime / 1000.0);
 
+        PROFILE_NEW_FRAME();
+        pass_timers.begin_frame();
         glfwPollEvents();
         inputHandler->Advance();
-        mCamera.Update(ddeltatime, *inputHandler);
+        if (benchmark) {
+            benchmark->move_camera(mCamera);
+            benchmark->begin_frame();
+        } else {
+            mCamera.Update(ddeltatime, *inputHandler);
+        }
         ImGui_ImplGlfwGL3_NewFrame();
 
         if (inputHandler->GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
             reload_shaders();
+            cpu_mesher.set_program(density_graph);
+            bake_tiles();
+            chunks.invalidate();
         }
         if (inputHandler->GetKeycodeState(GLFW_KEY_L) & JUST_PRESSED) {
             mode = GL_LINE;
@@ -244,27 +558,268 @@ edan35::Terrainer::run()
         glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-        cube_node.render(mCamera.GetWorldToClipMatrix(), cube_node.get_transform());
+        auto const world_to_clip = mCamera.GetWorldToClipMatrix();
+        frustum = Frustum::from_world_to_clip(world_to_clip);
+        frame.camera_position = glm::vec4(mCamera.mWorld.GetTranslation(), 1.0f);
+        frame_uniforms.update(frame);
+
+        begin_pass(pass_t::generation);
+        {
+            PROFILE_ZONE("Generate chunks");
+            PROFILE_GPU_ZONE("Generate chunks");
+            // Chunks whose extraction ran out of room are generated again,
+            // into a bigger buffer.
+            if (mesher == mesher_t::transform_feedback) {
+                for (auto& c : chunks.get_chunks()) {
+                    if (c.resident && c.generated && GPUMesher::check_extraction(c))
+                        c.generated = false;
+                }
+            }
+            chunks.update(mCamera.mWorld.GetTranslation());
+        }
+
+        {
+            PROFILE_ZONE("Upload CPU meshes");
+            PROFILE_GPU_ZONE("Upload CPU meshes");
+            for (auto const& m : cpu_mesher.collect()) {
+                for (auto& c : chunks.get_chunks()) {
+                    if (!c.resident || c.coord != m.coord || c.mesh_ticket != m.ticket)
+                        continue;
+                    mesh_pool.upload(c.pooled_mesh, m.vertices, m.normals, m.indices, mesh_streaming);
+                    break;
+                }
+            }
+            mesh_streaming.end_frame();
+        }
+
+        {
+            PROFILE_ZONE("Upload density tiles");
+            for (auto const& tile : density_tiles.collect())
+                density_pass.add_tile(*tile);
+        }
+        end_pass(pass_t::generation);
+
+        auto const chunk_shader = mesher == mesher_t::geometry_shader ? marching_shader : terrain_shader;
+        auto const camera_position = mCamera.mWorld.GetTranslation();
+        auto const use_mesh_pool = mesher == mesher_t::cpu;
+        drawn_chunks_nb = 0u;
+        occluded_chunks.clear();
+        batched_chunks.clear();
+        begin_pass(pass_t::terrain);
+        {
+            PROFILE_ZONE("Draw terrain");
+            PROFILE_GPU_ZONE("Draw terrain");
+            pipeline_statistics.begin();
+            // Only draw() clears the pending draws of the pool: queue none
+            // when it will not run.
+            auto const queue_pooled_draws = use_mesh_pool && pooled_terrain_shader != 0u;
+            for (auto& c : chunks.get_chunks()) {
+                if (!c.resident || !c.generated)
+                    continue;
+                auto const origin = chunks.get_chunk_origin(c.coord);
+                if (!frustum.intersects(origin, origin + glm::vec3(chunks.get_chunk_size())))
+                    continue;
+                if (use_occlusion_culling && occlusion_culler.is_occluded(c, chunks, camera_position)) {
+                    occluded_chunks.push_back(&c);
+                    continue;
+                }
+                ++drawn_chunks_nb;
+                if (use_occlusion_culling)
+                    batched_chunks.push_back(&c);
+                if (queue_pooled_draws) {
+                    auto const half_size = 0.5f * chunks.get_chunk_size();
+                    mesh_pool.add_draw(c.pooled_mesh, glm::vec4(origin + glm::vec3(half_size), half_size));
+                } else if (!use_mesh_pool) {
+                    draw_list.add(c.node, c.node.get_transform(), chunk_shader, get_chunk_uniforms(c));
+                }
+            }
+            draw_list.flush(world_to_clip);
+            if (queue_pooled_draws) {
+                // Vertices come out of the vertex shader in world space.
+                using utils::opengl::shader::get_uniform_location;
+                glUseProgram(pooled_terrain_shader);
+                glUniformMatrix4fv(get_uniform_location(pooled_terrain_shader, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(glm::mat4()));
+                glUniformMatrix4fv(get_uniform_location(pooled_terrain_shader, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(glm::mat4()));
+                glUniformMatrix4fv(get_uniform_location(pooled_terrain_shader, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(world_to_clip));
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, marble);
+                glUniform1i(get_uniform_location(pooled_terrain_shader, "marble_tex"), 0);
+                mesh_pool.draw();
+                glBindTexture(GL_TEXTURE_2D, 0u);
+                glUseProgram(0u);
+            }
+            pipeline_statistics.end();
+        }
+        collect_counters(false);
+        {
+            PROFILE_ZONE("Test occlusion");
+            PROFILE_GPU_ZONE("Test occlusion");
+            // Against the depth of everything drawn above.
+            occlusion_culler.test(bounding_box_shader, world_to_clip, chunks, occluded_chunks);
+            occlusion_culler.test(bounding_box_shader, world_to_clip, chunks, batched_chunks);
+        }
+        end_pass(pass_t::terrain);
+
+        begin_pass(pass_t::overlay);
+        {
+            PROFILE_ZONE("Overlay");
+            PROFILE_GPU_ZONE("Overlay");
+            GLStateInspection::View::Render();
+
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            bool opened = ImGui::Begin("Render Time", nullptr, ImVec2(120, 50), -1.0f, 0);
+            if (opened)
+                ImGui::Text("%.3f ms", ddeltatime);
+            ImGui::End();
 
-        GLStateInspection::View::Render();
+            opened = ImGui::Begin("Terrain", nullptr, ImVec2(240, 420), -1.0f, 0);
+            if (opened) {
+                auto mesher_id = static_cast<int>(mesher);
+                auto mesher_changed = ImGui::RadioButton("Geometry shader", &mesher_id, static_cast<int>(mesher_t::geometry_shader));
+                mesher_changed |= ImGui::RadioButton("Cached triangles", &mesher_id, static_cast<int>(mesher_t::transform_feedback));
+                mesher_changed |= ImGui::RadioButton("CPU threads", &mesher_id, static_cast<int>(mesher_t::cpu));
+                if (mesher_changed && mesher_id != static_cast<int>(mesher)) {
+                    mesher = static_cast<mesher_t>(mesher_id);
+                    chunks.invalidate();
+                }
+                auto noise_id = static_cast<int>(noise);
+                auto noise_changed = ImGui::RadioButton("Gradient noise", &noise_id, static_cast<int>(noise_kind::gradient));
+                noise_changed |= ImGui::RadioButton("Filtered noise_t", &noise_id, static_cast<int>(noise_kind::filtered));
+                if (noise_changed && noise_id != static_cast<int>(noise)) {
+                    noise = static_cast<noise_kind>(noise_id);
+                    density_pass.set_noise(noise);
+                    cpu_mesher.set_noise(noise);
+                    bake_tiles();
+                    chunks.invalidate();
+                }
+                auto tiles_id = static_cast<int>(tiles);
+                auto tiles_changed = ImGui::RadioButton("Evaluated density", &tiles_id, static_cast<int>(tile_format::none));
+                tiles_changed |= ImGui::RadioButton("R16F tiles", &tiles_id, static_cast<int>(tile_format::r16f));
+                tiles_changed |= ImGui::RadioButton("R8 SNORM tiles", &tiles_id, static_cast<int>(tile_format::r8_snorm));
+                if (tiles_changed && tiles_id != static_cast<int>(tiles)) {
+                    tiles = static_cast<tile_format>(tiles_id);
+                    bake_tiles();
+                    chunks.invalidate();
+                }
+                auto const baked = density_tiles.get_baked();
+                ImGui::Text("Baked tiles: %u (%u kB), %u pending", static_cast<unsigned int>(baked.first),
+                            static_cast<unsigned int>(baked.second / 1024u), static_cast<unsigned int>(density_tiles.get_pending_nb()));
+                ImGui::Text("Resident chunks: %u", static_cast<unsigned int>(chunks.get_resident_nb()));
+                ImGui::Text("Generated this frame: %u", static_cast<unsigned int>(chunks.get_generated_nb()));
+                ImGui::Text("Drawn chunks: %u", static_cast<unsigned int>(drawn_chunks_nb));
+                ImGui::Text("Culled before generation: %u", static_cast<unsigned int>(chunks.get_culled_nb()));
+                if (ImGui::Checkbox("Occlusion culling", &use_occlusion_culling) && !use_occlusion_culling)
+                    for (auto& c : chunks.get_chunks())
+                        OcclusionCuller::reset(c);
+                ImGui::Text("Occluded chunks: %u", static_cast<unsigned int>(occluded_chunks.size()));
+                ImGui::Text("Upload stalls: %u", static_cast<unsigned int>(mesh_streaming.get_stalls_nb()));
+                ImGui::Text("Draw list state changes: %u", static_cast<unsigned int>(draw_list.get_state_changes_nb()));
+                ImGui::Text("Mesh pool: %u / %u kB", static_cast<unsigned int>(mesh_pool.get_used_size() / 1024u),
+                            static_cast<unsigned int>(mesh_pool.get_capacity() / 1024u));
+                unsigned int level_chunks_nb[constant::chunk_lod_levels_nb] = {};
+                for (auto const& c : chunks.get_chunks())
+                    if (c.resident && c.lod.level < constant::chunk_lod_levels_nb)
+                        ++level_chunks_nb[c.lod.level];
+                ImGui::Text("Chunks per level: %u / %u / %u / %u", level_chunks_nb[0], level_chunks_nb[1], level_chunks_nb[2], level_chunks_nb[3]);
+                if (mesher == mesher_t::cpu)
+                    ImGui::Text("Pending CPU meshes: %u", static_cast<unsigned int>(cpu_mesher.get_pending_nb()));
+            }
+            ImGui::End();
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        bool opened = ImGui::Begin("Render Time", nullptr, ImVec2(120, 50), -1.0f, 0);
-        if (opened)
-            ImGui::Text("%.3f ms", ddeltatime);
-        ImGui::End();
+            opened = ImGui::Begin("Pipeline Statistics", nullptr, ImVec2(280, 160), -1.0f, 0);
+            if (opened) {
+                auto const show_counter = [](char const* name, GLint64 value) {
+                    if (value < 0)
+                        ImGui::Text("%s: n/a", name);
+                    else
+                        ImGui::Text("%s: %lld", name, static_cast<long long>(value));
+                };
+                show_counter("Primitives generated", latest_counters.primitives_generated);
+                show_counter("GS invocations", latest_counters.gs_invocations);
+                show_counter("GS primitives emitted", latest_counters.gs_primitives);
+                show_counter("Clipping input primitives", latest_counters.clipping_input);
+                show_counter("Clipping output primitives", latest_counters.clipping_output);
+                show_counter("Fragment invocations", latest_counters.fragment_invocations);
+                if (!pipeline_statistics.is_detailed())
+                    ImGui::Text("GL_ARB_pipeline_statistics_query unavailable");
+            }
+            ImGui::End();
 
-        Log::View::Render();
-        ImGui::Render();
+            opened = ImGui::Begin("GPU Passes", nullptr, ImVec2(420, 150), -1.0f, 0);
+            if (opened) {
+                ImGui::Columns(6, "pass_times");
+                for (auto const header : { "Pass", "Avg", "Median", "95%", "99%", "Max" }) {
+                    ImGui::Text("%s", header);
+                    ImGui::NextColumn();
+                }
+                for (size_t pass = 0u; pass < pass_timers.get_passes_nb(); ++pass) {
+                    auto const stats = pass_timers.get_statistics(pass);
+                    ImGui::Text("%s", pass_timers.get_name(pass).c_str());
+                    ImGui::NextColumn();
+                    for (auto const value : { stats.average, stats.median, stats.p95, stats.p99, stats.max }) {
+                        ImGui::Text("%.3f", value);
+                        ImGui::NextColumn();
+                    }
+                }
+                ImGui::Columns(1);
+                ImGui::Text("In ms, over the last %u frames; %u frames dropped", static_cast<unsigned int>(constant::pass_history_size),
+                            static_cast<unsigned int>(pass_timers.get_dropped_frames_nb()));
+            }
+            ImGui::End();
 
-        window->Swap();
+            Log::View::Render();
+            Profiler::View::Render();
+            ImGui::Render();
+        }
+        end_pass(pass_t::overlay);
+
+        if (benchmark) {
+            benchmark->end_frame(GetTimeMilliseconds() - nowTime);
+            if (benchmark->is_done())
+                glfwSetWindowShouldClose(window->GetGLFW_Window(), GLFW_TRUE);
+        }
+
+        begin_pass(pass_t::swap);
+        {
+            PROFILE_ZONE("Swap");
+            window->Swap();
+        }
+        end_pass(pass_t::swap);
         lastTime = nowTime;
     }
 
+    collect_counters(true);
+    auto const benchmark_written = !benchmark || benchmark->write(bench_settings.output_path);
+    benchmark.reset();
+
+    for (auto& c : chunks.get_chunks()) {
+        GPUMesher::release(c);
+        DensityPass::release(c);
+        OcclusionCuller::release(c);
+    }
+    density_pass.clear_tiles();
+    glDeleteTextures(1, &noise_t);
+    noise_t = 0u;
+
+    glDeleteProgram(bounding_box_shader);
+    bounding_box_shader = 0u;
+    glDeleteProgram(pooled_terrain_shader);
+    pooled_terrain_shader = 0u;
+    glDeleteProgram(terrain_shader);
+    terrain_shader = 0u;
+    glDeleteProgram(extract_shader);
+    extract_shader = 0u;
+    glDeleteProgram(classify_shader);
+    classify_shader = 0u;
+    glDeleteProgram(density_shader);
+    density_shader = 0u;
     glDeleteProgram(fallback_shader);
     fallback_shader = 0u;
     glDeleteProgram(marching_shader);
     marching_shader = 0u;
+
+    if (!benchmark_written)
+        throw std::runtime_error("Failed to write the benchmark results to \"" + bench_settings.output_path + "\"");
 }
 
 int*
@@ -532,14 +1087,77 @@ edan35::Terrainer::create_edge_conn()
     return edge_conn;
 }
 
-int main()
+static void print_usage(char const* program)
+{
+    printf("Usage: %s [--bench [FRAMES_NB]] [--output PATH] [--noise gradient|filtered]\n"
+           "       [--tiles none|r16f|r8_snorm]\n"
+           "  --bench [FRAMES_NB]  fly a fixed camera path in a hidden window and record\n"
+           "                       the CPU and GPU time of FRAMES_NB frames (default: %u)\n"
+           "  --output PATH        where to write the benchmark results, as JSON if PATH\n"
+           "                       ends with \".json\", as CSV otherwise (default: %s)\n"
+           "  --noise KIND         noise the terrain is made of: \"gradient\" hashes the\n"
+           "                       lattice corners, \"filtered\" samples a texture with\n"
+           "                       hardware filtering (default: gradient)\n"
+           "  --tiles FORMAT       how the density of the chunks around the origin is\n"
+           "                       baked, \"none\" evaluating it for every chunk instead\n"
+           "                       (default: r16f)\n",
+           program, static_cast<unsigned int>(edan35::benchmark_settings().frames_nb),
+           edan35::benchmark_settings().output_path.c_str());
+}
+
+int main(int argc, char* argv[])
 {
+    edan35::benchmark_settings bench;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--bench") == 0) {
+            bench.enabled = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                auto const frames_nb = std::strtol(argv[++i], nullptr, 10);
+                if (frames_nb <= 0) {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                bench.frames_nb = static_cast<size_t>(frames_nb);
+            }
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            bench.output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "gradient") == 0) {
+                bench.noise = edan35::noise_kind::gradient;
+            } else if (std::strcmp(argv[i], "filtered") == 0) {
+                bench.noise = edan35::noise_kind::filtered;
+            } else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "none") == 0) {
+                bench.tiles = edan35::tile_format::none;
+            } else if (std::strcmp(argv[i], "r16f") == 0) {
+                bench.tiles = edan35::tile_format::r16f;
+            } else if (std::strcmp(argv[i], "r8_snorm") == 0) {
+                bench.tiles = edan35::tile_format::r8_snorm;
+            } else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto status = EXIT_SUCCESS;
     Bonobo::Init();
     try {
-        edan35::Terrainer terrainer;
+        edan35::Terrainer terrainer(bench);
         terrainer.run();
     } catch (std::runtime_error const& e) {
         LogError(e.what());
+        status = EXIT_FAILURE;
     }
     Bonobo::Destroy();
+    return status;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "benchmark.hpp"
 
 class InputHandler;
 class Window;
@@ -14,7 +15,11 @@ namespace edan35
         //!
         //! It will initialise various modules of bonobo and retrieve a
         //! window to draw to.
-        Terrainer();
+        //!
+        //! @param [in] bench if enabled, the window is hidden and `run()`
+        //!             records a benchmark instead of following the user's
+        //!             input
+        Terrainer(benchmark_settings const& bench = benchmark_settings());
 
         //! \brief Default destructor.
         //!
@@ -24,12 +29,16 @@ namespace edan35
 
         //! \brief Contains the logic of the assignment, along with the
         //! render loop.
+        //!
+        //! Throws a `std::runtime_error` if the benchmark results could not
+        //! be written.
         void run();
 
         int* create_edge_conn();
 
     private:
-        InputHandler *inputHandler;
-        Window       *window;
+        InputHandler       *inputHandler;
+        Window             *window;
+        benchmark_settings  bench_settings;
     };
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "Profiler.h"
+
+#include "Misc.h"
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler {
+
+static Frame lastFrame = {};
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+
+/*----------------------------------------------------------------------------*/
+
+static std::size_t const EVENT_BUFFER_SIZE = 8192;
+static std::size_t const GPU_FRAMES_IN_FLIGHT = 4;
+
+struct Event {
+	char const *mName;	// nullptr for the end of the innermost open zone
+	u64 mTime;
+};
+
+/*
+ * Single-producer single-consumer ring: the owning thread writes events
+ * and publishes them by advancing mHead, NewFrame() consumes them and
+ * releases their slots by advancing mTail.
+ */
+struct ThreadBuffer {
+	Event mEvents[EVENT_BUFFER_SIZE];
+	std::atomic<std::size_t> mHead;
+	std::atomic<std::size_t> mTail;
+	std::vector<bool> mRecorded;	// owner only: whether each open zone made it into the ring
+	std::size_t mRecordedCount;		// owner only: how many of them did
+	std::vector<Event> mOpen;		// NewFrame() only: begin events awaiting their end
+	u32 mIndex;
+
+	ThreadBuffer(u32 index) : mHead(0), mTail(0), mRecordedCount(0), mIndex(index) {}
+};
+
+/*
+ * Buffers are never freed, as threads keep a pointer to theirs for their
+ * whole lifetime; the mutex is only taken when a thread records its first
+ * zone, and once per frame by NewFrame().
+ */
+static std::mutex threadBuffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+static thread_local ThreadBuffer *threadBuffer = nullptr;
+
+struct GPUFrame {
+	std::vector<GLuint> mQueries;
+	std::vector<char const *> mNames;
+	std::size_t mUsed;
+};
+
+static std::array<GPUFrame, GPU_FRAMES_IN_FLIGHT> gpuFrames;
+static std::size_t gpuFrameIndex = 0;
+static u32 gpuDepth = 0;
+static u64 frameStart = 0;
+
+/*----------------------------------------------------------------------------*/
+
+static ThreadBuffer &GetThreadBuffer()
+{
+	if (threadBuffer == nullptr) {
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+		threadBuffers.emplace_back(new ThreadBuffer(static_cast<u32>(threadBuffers.size())));
+		threadBuffer = threadBuffers.back().get();
+	}
+	return *threadBuffer;
+}
+
+static void Push(ThreadBuffer &buffer, char const *name, u64 time)
+{
+	std::size_t head = buffer.mHead.load(std::memory_order_relaxed);
+	buffer.mEvents[head % EVENT_BUFFER_SIZE].mName = name;
+	buffer.mEvents[head % EVENT_BUFFER_SIZE].mTime = time;
+	buffer.mHead.store(head + 1, std::memory_order_release);
+}
+
+static void Drain(ThreadBuffer &buffer, std::vector<Zone> &zones)
+{
+	std::size_t tail = buffer.mTail.load(std::memory_order_relaxed);
+	std::size_t head = buffer.mHead.load(std::memory_order_acquire);
+	for (; tail != head; ++tail) {
+		Event const &event = buffer.mEvents[tail % EVENT_BUFFER_SIZE];
+		if (event.mName != nullptr) {
+			buffer.mOpen.push_back(event);
+			continue;
+		}
+		if (buffer.mOpen.empty())
+			continue;
+		Zone zone;
+		zone.mName = buffer.mOpen.back().mName;
+		zone.mStart = buffer.mOpen.back().mTime;
+		zone.mEnd = event.mTime;
+		zone.mDepth = static_cast<u32>(buffer.mOpen.size() - 1);
+		zone.mThread = buffer.mIndex;
+		zones.push_back(zone);
+		buffer.mOpen.pop_back();
+	}
+	buffer.mTail.store(tail, std::memory_order_release);
+}
+
+static void ReadGPUFrame(GPUFrame &gpuFrame, std::vector<Zone> &zones)
+{
+	if (gpuFrame.mUsed == 0)
+		return;
+
+	// Queries complete in order: if the last one is done, all of them are.
+	// Otherwise the GPU is more than GPU_FRAMES_IN_FLIGHT frames behind,
+	// and the previous results are kept rather than waiting for it.
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(gpuFrame.mQueries[gpuFrame.mUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_TRUE) {
+		zones.clear();
+		u64 offset = 0;
+		for (std::size_t i = 0; i < gpuFrame.mUsed; i++) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(gpuFrame.mQueries[i], GL_QUERY_RESULT, &elapsed);
+			Zone zone;
+			zone.mName = gpuFrame.mNames[i];
+			zone.mStart = offset;
+			zone.mEnd = offset + elapsed;
+			zone.mDepth = 0;
+			zone.mThread = 0;
+			zones.push_back(zone);
+			offset += elapsed;
+		}
+	}
+	gpuFrame.mUsed = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void Init()
+{
+	frameStart = GetTimeNanoseconds();
+	lastFrame.mStart = lastFrame.mEnd = frameStart;
+}
+
+void Destroy()
+{
+	for (GPUFrame &gpuFrame : gpuFrames) {
+		if (!gpuFrame.mQueries.empty())
+			glDeleteQueries(static_cast<GLsizei>(gpuFrame.mQueries.size()), gpuFrame.mQueries.data());
+		gpuFrame.mQueries.clear();
+		gpuFrame.mNames.clear();
+		gpuFrame.mUsed = 0;
+	}
+	gpuDepth = 0;
+	lastFrame.mCPUZones.clear();
+	lastFrame.mGPUZones.clear();
+}
+
+/*----------------------------------------------------------------------------*/
+
+void NewFrame()
+{
+	u64 now = GetTimeNanoseconds();
+	lastFrame.mStart = frameStart;
+	lastFrame.mEnd = now;
+	frameStart = now;
+
+	lastFrame.mCPUZones.clear();
+	{
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+		for (auto &buffer : threadBuffers)
+			Drain(*buffer, lastFrame.mCPUZones);
+		lastFrame.mThreadCount = static_cast<u32>(threadBuffers.size());
+	}
+
+	gpuFrameIndex = (gpuFrameIndex + 1) % GPU_FRAMES_IN_FLIGHT;
+	ReadGPUFrame(gpuFrames[gpuFrameIndex], lastFrame.mGPUZones);
+}
+
+Frame const &GetLastFrame()
+{
+	return lastFrame;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void BeginZone(char const *name)
+{
+	ThreadBuffer &buffer = GetThreadBuffer();
+	std::size_t head = buffer.mHead.load(std::memory_order_relaxed);
+	std::size_t tail = buffer.mTail.load(std::memory_order_acquire);
+	// Keep room for closing every recorded zone, so that an end event is
+	// never dropped after its begin event was recorded.
+	bool record = EVENT_BUFFER_SIZE - (head - tail) >= buffer.mRecordedCount + 2;
+	buffer.mRecorded.push_back(record);
+	if (!record)
+		return;
+	++buffer.mRecordedCount;
+	Push(buffer, name, GetTimeNanoseconds());
+}
+
+void EndZone()
+{
+	u64 now = GetTimeNanoseconds();
+	ThreadBuffer &buffer = GetThreadBuffer();
+	if (buffer.mRecorded.empty())
+		return;
+	bool recorded = buffer.mRecorded.back();
+	buffer.mRecorded.pop_back();
+	if (!recorded)
+		return;
+	--buffer.mRecordedCount;
+	Push(buffer, nullptr, now);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void BeginGPUZone(char const *name)
+{
+	if (gpuDepth++ != 0)
+		return;
+
+	GPUFrame &gpuFrame = gpuFrames[gpuFrameIndex];
+	if (gpuFrame.mUsed == gpuFrame.mQueries.size()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		gpuFrame.mQueries.push_back(query);
+		gpuFrame.mNames.push_back(nullptr);
+	}
+	gpuFrame.mNames[gpuFrame.mUsed] = name;
+	glBeginQuery(GL_TIME_ELAPSED, gpuFrame.mQueries[gpuFrame.mUsed]);
+	++gpuFrame.mUsed;
+}
+
+void EndGPUZone()
+{
+	if (gpuDepth == 0 || --gpuDepth != 0)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+/*----------------------------------------------------------------------------*/
+
+#else // ENABLE_PROFILING
+
+void Init() {}
+void Destroy() {}
+void NewFrame() {}
+Frame const &GetLastFrame() { return lastFrame; }
+void BeginZone(char const *) {}
+void EndZone() {}
+void BeginGPUZone(char const *) {}
+void EndGPUZone() {}
+
+#endif // ENABLE_PROFILING
+
+};
@@ -0,0 +1,87 @@
+/*
+ * CPU and GPU profiling
+ */
+
+#pragma once
+
+#include "BuildSettings.h"
+#include "Types.h"
+
+#include <vector>
+
+namespace Profiler {
+
+/** A profiled section of code, either on the CPU or on the GPU */
+struct Zone {
+	char const *mName;		// as given to BeginZone() or BeginGPUZone()
+	u64 mStart, mEnd;		// in nanoseconds; see Frame for their origin
+	u32 mDepth;				// number of zones enclosing this one on the same thread
+	u32 mThread;			// index of the thread in registration order; 0 for GPU zones
+};
+
+/** Everything recorded between two calls to NewFrame() */
+struct Frame {
+	u64 mStart, mEnd;				// CPU timestamps, as returned by GetTimeNanoseconds()
+	std::vector<Zone> mCPUZones;	// zones which ended during the frame, with CPU timestamps
+	std::vector<Zone> mGPUZones;	// zones of an older frame, laid out back to back from 0, as only their duration is known
+	u32 mThreadCount;
+};
+
+void Init();
+void Destroy();
+
+/**
+ * Close the current frame, gathering the zones recorded by every thread,
+ * and the GPU zones whose results are available. Call once per frame,
+ * from the thread owning the GL context.
+ */
+void NewFrame();
+/** Return the frame closed by the latest call to NewFrame() */
+Frame const &GetLastFrame();
+
+/**
+ * Open a zone on the calling thread; zones nest, and must be closed in
+ * reverse order. The name is kept as is, so must outlive the profiler,
+ * e.g. a string literal. Recording does not lock: every thread writes to
+ * its own buffer, and zones are dropped if it is full.
+ */
+void BeginZone(char const *name);
+void EndZone();
+
+/**
+ * Open a zone timing the GL commands issued until EndGPUZone(), from the
+ * thread owning the GL context. GL_TIME_ELAPSED queries cannot nest:
+ * zones opened inside another GPU zone are merged into it.
+ */
+void BeginGPUZone(char const *name);
+void EndGPUZone();
+
+class ScopedZone {
+public:
+	explicit ScopedZone(char const *name) { BeginZone(name); }
+	~ScopedZone() { EndZone(); }
+	ScopedZone(ScopedZone const&) = delete;
+	ScopedZone &operator=(ScopedZone const&) = delete;
+};
+
+class ScopedGPUZone {
+public:
+	explicit ScopedGPUZone(char const *name) { BeginGPUZone(name); }
+	~ScopedGPUZone() { EndGPUZone(); }
+	ScopedGPUZone(ScopedGPUZone const&) = delete;
+	ScopedGPUZone &operator=(ScopedGPUZone const&) = delete;
+};
+
+};
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+#	define PROFILER_CONCAT_(a, b)	a##b
+#	define PROFILER_CONCAT(a, b)	PROFILER_CONCAT_(a, b)
+#	define PROFILE_ZONE(name)		Profiler::ScopedZone PROFILER_CONCAT(profilerZone, __LINE__)(name)
+#	define PROFILE_GPU_ZONE(name)	Profiler::ScopedGPUZone PROFILER_CONCAT(profilerGPUZone, __LINE__)(name)
+#	define PROFILE_NEW_FRAME()		Profiler::NewFrame()
+#else
+#	define PROFILE_ZONE(name)
+#	define PROFILE_GPU_ZONE(name)
+#	define PROFILE_NEW_FRAME()
+#endif
@@ -0,0 +1,104 @@
+#include <imgui.h>
+
+#include "BuildSettings.h"
+#include "ProfilerView.h"
+
+#include <algorithm>
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+
+static float const zoneHeight = 18.0f;
+static bool paused = false;
+static Profiler::Frame pausedFrame;
+
+static ImU32 ZoneColor(char const *name)
+{
+	// Hashing the name keeps the colour of a zone from one frame to the next.
+	u32 hash = 2166136261u;
+	for (char const *c = name; *c != '\0'; c++)
+		hash = (hash ^ static_cast<u8>(*c)) * 16777619u;
+	float r = 0.3f + 0.4f * static_cast<float>((hash >> 0) & 0xff) / 255.0f;
+	float g = 0.3f + 0.4f * static_cast<float>((hash >> 8) & 0xff) / 255.0f;
+	float b = 0.3f + 0.4f * static_cast<float>((hash >> 16) & 0xff) / 255.0f;
+	return ImGui::ColorConvertFloat4ToU32(ImVec4(r, g, b, 1.0f));
+}
+
+/*
+ * Draw the zones of a thread as bars spanning [start, end], nested zones
+ * one row below their parent.
+ */
+static void RenderTimeline(std::vector<Profiler::Zone> const &zones, u32 thread, u64 start, u64 end)
+{
+	ImDrawList *drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = ImGui::GetWindowContentRegionWidth();
+	float scale = width / static_cast<float>(std::max<u64>(end - start, 1));
+	ImU32 textColor = ImGui::ColorConvertFloat4ToU32(ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
+
+	u32 depthCount = 0;
+	for (Profiler::Zone const &zone : zones) {
+		if (zone.mThread != thread || zone.mEnd < start || zone.mStart > end)
+			continue;
+		depthCount = std::max(depthCount, zone.mDepth + 1);
+
+		float x0 = origin.x + scale * static_cast<float>(std::max(zone.mStart, start) - start);
+		float x1 = origin.x + scale * static_cast<float>(std::min(zone.mEnd, end) - start);
+		x1 = std::max(x1, x0 + 1.0f);
+		float y0 = origin.y + static_cast<float>(zone.mDepth) * zoneHeight;
+		float y1 = y0 + zoneHeight - 1.0f;
+		drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ZoneColor(zone.mName));
+		drawList->PushClipRect(ImVec4(x0, y0, x1, y1));
+		drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), textColor, zone.mName);
+		drawList->PopClipRect();
+
+		if (ImGui::IsMouseHoveringRect(ImVec2(x0, y0), ImVec2(x1, y1)))
+			ImGui::SetTooltip("%s: %.3f ms", zone.mName, static_cast<double>(zone.mEnd - zone.mStart) * 0.000001);
+	}
+	ImGui::Dummy(ImVec2(width, static_cast<float>(depthCount) * zoneHeight));
+}
+
+#endif // ENABLE_PROFILING
+
+void Profiler::View::Init()
+{
+}
+
+void Profiler::View::Destroy()
+{
+}
+
+void Profiler::View::Render()
+{
+	bool opened = ImGui::Begin("Profiler", nullptr, ImVec2(600, 300), -1.0f, 0);
+	if (opened) {
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+		bool wasPaused = paused;
+		ImGui::Checkbox("Pause", &paused);
+		if (paused && !wasPaused)
+			pausedFrame = Profiler::GetLastFrame();
+		Profiler::Frame const &frame = paused ? pausedFrame : Profiler::GetLastFrame();
+
+		u64 frameLength = frame.mEnd - frame.mStart;
+		ImGui::Text("CPU: %.3f ms", static_cast<double>(frameLength) * 0.000001);
+		for (u32 thread = 0; thread < frame.mThreadCount; thread++) {
+			bool hasZones = std::any_of(frame.mCPUZones.begin(), frame.mCPUZones.end(),
+			                            [thread](Profiler::Zone const &zone) { return zone.mThread == thread; });
+			if (!hasZones)
+				continue;
+			ImGui::Text("Thread %u", thread);
+			RenderTimeline(frame.mCPUZones, thread, frame.mStart, frame.mEnd);
+		}
+
+		// Drawn to the same scale as the CPU frame, unless longer.
+		if (!frame.mGPUZones.empty()) {
+			u64 gpuLength = frame.mGPUZones.back().mEnd;
+			ImGui::Text("GPU: %.3f ms in zones, a few frames ago", static_cast<double>(gpuLength) * 0.000001);
+			RenderTimeline(frame.mGPUZones, 0, 0, std::max(gpuLength, frameLength));
+		}
+#else
+		ImGui::Text("Profiling disabled");
+		ImGui::Text("Enable with ENABLE_PROFILING in BuildSettings.h");
+#endif
+	}
+	ImGui::End();
+}
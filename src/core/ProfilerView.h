@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Profiler.h"
+
+namespace Profiler {
+
+class View {
+public:
+	static void Init();
+	static void Destroy();
+public:
+	static void Render();
+};
+
+};
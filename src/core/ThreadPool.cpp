@@ -0,0 +1,59 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t threadCount) : mWorkers(), mTasks(), mMutex(), mTaskAvailable(), mIdle(), mBusyCount(0), mStopping(false)
+{
+	if (threadCount == 0) {
+		auto const hardwareThreads = static_cast<std::size_t>(std::thread::hardware_concurrency());
+		threadCount = std::max<std::size_t>(hardwareThreads, 2) - 1;
+	}
+	mWorkers.reserve(threadCount);
+	for (std::size_t i = 0; i < threadCount; i++)
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mTaskAvailable.notify_all();
+	for (auto &worker : mWorkers)
+		worker.join();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]() { return mTasks.empty() && mBusyCount == 0; });
+}
+
+std::size_t ThreadPool::GetThreadCount() const
+{
+	return mWorkers.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;) {
+		std::function<void ()> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mTaskAvailable.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+			if (mTasks.empty())
+				return; // only reached when stopping
+			task = std::move(mTasks.front());
+			mTasks.pop();
+			mBusyCount++;
+		}
+		task();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBusyCount--;
+			if (mTasks.empty() && mBusyCount == 0)
+				mIdle.notify_all();
+		}
+	}
+}
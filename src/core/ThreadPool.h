@@ -0,0 +1,60 @@
+/*
+ * Fixed-size pool of worker threads consuming a shared task queue
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+public:
+	/** Start the workers; 0 uses one worker per hardware thread minus one, with at least one worker */
+	explicit ThreadPool(std::size_t threadCount = 0);
+	/** Finish all queued tasks, then join the workers */
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool &operator=(ThreadPool const&) = delete;
+
+public:
+	/** Queue a task; the returned future holds its result, or the exception it threw */
+	template<typename F> auto Enqueue(F &&task) -> std::future<decltype(task())>;
+	/** Block until the queue is empty and no worker is busy */
+	void Wait();
+	std::size_t GetThreadCount() const;
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> mWorkers;
+	std::queue<std::function<void ()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mTaskAvailable;
+	std::condition_variable mIdle;
+	std::size_t mBusyCount;
+	bool mStopping;
+};
+
+template<typename F> auto ThreadPool::Enqueue(F &&task) -> std::future<decltype(task())>
+{
+	using R = decltype(task());
+	auto packaged = std::make_shared<std::packaged_task<R ()>>(std::forward<F>(task));
+	auto future = packaged->get_future();
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTasks.emplace([packaged]() { (*packaged)(); });
+	}
+	mTaskAvailable.notify_one();
+	return future;
+}
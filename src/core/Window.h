@@ -21,12 +21,12 @@ public:
 	};
 public:
 	static void Init();
-	static Window *Create(std::string title, unsigned int w, unsigned int h, unsigned int msaa = 4, bool fullscreen = false, bool resizable_ = true, SwapStrategy swap = ENABLE_VSYNC);
+	static Window *Create(std::string title, unsigned int w, unsigned int h, unsigned int msaa = 4, bool fullscreen = false, bool resizable_ = true, SwapStrategy swap = ENABLE_VSYNC, bool visible = true);
 	static bool Destroy(Window *window);
 	static void Destroy();
 
 protected:
-	Window(std::string title, unsigned int w, unsigned int h, unsigned int msaa, bool fullscreen_, bool resizable_, SwapStrategy swap_);
+	Window(std::string title, unsigned int w, unsigned int h, unsigned int msaa, bool fullscreen_, bool resizable_, SwapStrategy swap_, bool visible_);
 	~Window();
 public:
 	void SetFullscreen(bool state);
@@ -49,6 +49,7 @@ private:
 	unsigned int mMSAA;
 	bool mFullscreen;
 	bool mResizable;
+	bool mVisible;
 	SwapStrategy mSwap;
 	GLFWwindow *mWindowGLFW;
 	InputHandler *mInputHandler;
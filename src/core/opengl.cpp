@@ -6,6 +6,7 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <unordered_map>
 
 
 namespace utils
@@ -122,6 +123,16 @@ opengl_error_callback( GLenum source, GLenum type, GLuint id, GLenum severity
 namespace shader
 {
 
+// Locations looked up since the latest link of every program; a program
+// name can be reused once deleted, but the new program gets linked before
+// any lookup.
+struct program_uniforms {
+	size_t link_id;
+	std::unordered_map<std::string, GLint> locations;
+};
+static auto programs_uniforms = std::unordered_map<GLuint, program_uniforms>();
+static auto links_nb = size_t(0u);
+
 bool
 source_and_build_shader(GLuint id, std::string const& source)
 {
@@ -175,6 +186,10 @@ bool
 link_program(GLuint id)
 {
 	glLinkProgram(id);
+	auto& uniforms = programs_uniforms[id];
+	uniforms.link_id = ++links_nb;
+	uniforms.locations.clear();
+
 	GLint state = GLint(0);
 	glGetProgramiv(id, GL_LINK_STATUS, &state);
 	if (state == GL_FALSE)
@@ -205,6 +220,26 @@ reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::strin
 	link_program(id);
 }
 
+GLint
+get_uniform_location(GLuint program, std::string const& name)
+{
+	auto& locations = programs_uniforms[program].locations;
+	auto const it = locations.find(name);
+	if (it != locations.end())
+		return it->second;
+
+	auto const location = glGetUniformLocation(program, name.c_str());
+	locations.emplace(name, location);
+	return location;
+}
+
+size_t
+get_link_id(GLuint program)
+{
+	auto const it = programs_uniforms.find(program);
+	return it != programs_uniforms.end() ? it->second.link_id : 0u;
+}
+
 GLuint
 generate_program(std::vector<GLuint> const& shaders_id)
 {
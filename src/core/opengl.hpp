@@ -3,6 +3,7 @@
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,12 @@ bool source_and_build_shader(GLuint id, std::string const& source);
 GLuint generate_shader(GLenum type, std::string const& source);
 bool link_program(GLuint id);
 void reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::string> const& sources);
+// Location of a uniform, only queried from OpenGL once per link of the
+// program; `program` must have been linked through `link_program()`.
+GLint get_uniform_location(GLuint program, std::string const& name);
+// Identifies the latest link of a program, 0 if never linked: locations
+// cached by callers are stale once it changes.
+size_t get_link_id(GLuint program);
 GLuint generate_program(std::vector<GLuint> const& shaders_id);
 
 } // end of namespace shader